@@ -0,0 +1,16 @@
+#include "analysis.h"
+using namespace std;
+
+void runMissRatioAnalysis(TraceReader *trace)
+{
+	const Config config = getConfig("trace.config");
+	MissRatioAnalysis *analysis = new MissRatioAnalysis(config);
+	const TraceRecord *batch;
+	size_t count;
+
+	while ((count = trace->nextBatch(batch)) > 0) {
+		analysis->analyze(batch, count);
+	}
+	analysis->printMissRatios();
+	delete analysis;
+}
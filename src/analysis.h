@@ -0,0 +1,376 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "cache.h"
+#include "config.h"
+#include "error.h"
+#include "frames.h"
+#include "page_table.h"
+#include "trace.h"
+
+using namespace std;
+
+// the misses of every LRU geometry of one cache or TLB, by set count (2^width
+// sets) and associativity (1 to MAX_SET_SIZE ways)
+class GeometryMisses
+{
+public:
+	virtual ~GeometryMisses()
+	{
+	}
+	// allocate false leaves a missing line out, as a write-through write does
+	virtual void access(uint64_t index_address, uint64_t tag_address, unsigned int frame, bool allocate) = 0;
+	virtual void invalidateEntries(unsigned int frame) = 0;
+	virtual unsigned long referenceCount() = 0;
+	virtual unsigned long misses(int width, int ways) = 0;
+	virtual int widths() = 0;
+	// false once a hit came from another frame (see StackDistanceProfile)
+	virtual bool framesAgree()
+	{
+		return true;
+	}
+};
+
+class StackDistanceProfile : public GeometryMisses
+{
+public:
+	// LRU stack distances of one cache or TLB for every power-of-two set count
+	// up to max_sets in a single pass. LRU has the inclusion property: a set
+	// of an n-way cache holds the n most recently filled entries of its
+	// recency stack, so a reference found at depth d hits in every cache of at
+	// least d ways. Only the top MAX_SET_SIZE entries of each stack matter.
+	// Entries record the generation of their frame when they were filled, and
+	// evicting a frame bumps its generation, which invalidates the frame's
+	// entries in all stacks at once just like Cache::invalidateEntries.
+	// A hit keeps the entry's frame, as Cache::readEntry does, but a hit at
+	// depth d from another frame is a miss in the caches of d ways or fewer,
+	// which refill the line from the new frame; an entry cannot hold both,
+	// so such a hit clears framesAgree and the profile stops being exact
+	StackDistanceProfile(int max_sets, int offset_bits, const unsigned int *g)
+	{
+		generations = g;
+		num_widths = __builtin_ctz(max_sets) + 1;
+		references = 0;
+		frames_agree = true;
+		for (int w = 0; w < num_widths; ++w) {
+			index_fields.push_back(makeField(offset_bits, w));
+			tag_fields.push_back(makeField(offset_bits + w, MAX_TAG_BITS));
+			StackEntry *stack = new StackEntry[(1 << w) * MAX_SET_SIZE];
+			for (int i = 0; i < (1 << w) * MAX_SET_SIZE; ++i) {
+				stack[i].tag = UINT64_MAX;
+				stack[i].frame = UINT_MAX; // never valid
+				stack[i].generation = 0;
+			}
+			stacks.push_back(stack);
+			depth_counts.push_back(vector<unsigned long>(MAX_SET_SIZE, 0));
+		}
+	}
+	~StackDistanceProfile()
+	{
+		for (int w = 0; w < num_widths; ++w) {
+			delete[] stacks[w];
+		}
+	}
+	void access(uint64_t index_address, uint64_t tag_address, unsigned int frame, bool)
+	{
+		++references;
+		for (int w = 0; w < num_widths; ++w) {
+			StackEntry *stack = stacks[w] + index_fields[w].extract(index_address) * MAX_SET_SIZE;
+			uint64_t tag = tag_fields[w].extract(tag_address);
+			int depth = 0;
+			while (depth < MAX_SET_SIZE && !(stack[depth].tag == tag && isValid(stack[depth]))) {
+				++depth;
+			}
+			// move the entry, which keeps the frame it was filled from, or the
+			// refill to the top of the stack
+			StackEntry top;
+			if (depth < MAX_SET_SIZE) {
+				++depth_counts[w][depth];
+				top = stack[depth];
+				frames_agree = frames_agree && (top.frame == frame);
+			} else {
+				depth = MAX_SET_SIZE - 1; // a miss for every associativity drops the bottom entry
+				top.tag = tag;
+				top.frame = frame;
+				top.generation = generations[frame];
+			}
+			memmove(stack + 1, stack, depth * sizeof(StackEntry));
+			stack[0] = top;
+		}
+	}
+	void invalidateEntries(unsigned int)
+	{
+		// the caller bumps the frame's generation instead
+	}
+	unsigned long referenceCount()
+	{
+		return references;
+	}
+	unsigned long misses(int width, int ways)
+	{
+		// references deeper than ways in the stack of 2^width sets
+		unsigned long hits = 0;
+		for (int d = 0; d < ways; ++d) {
+			hits += depth_counts[width][d];
+		}
+		return references - hits;
+	}
+	int widths()
+	{
+		return num_widths;
+	}
+	bool framesAgree()
+	{
+		return frames_agree;
+	}
+private:
+	struct StackEntry
+	{
+		uint64_t tag;
+		unsigned int frame;
+		unsigned int generation;
+	};
+
+	bool isValid(const StackEntry& e)
+	{
+		return e.frame != UINT_MAX && e.generation == generations[e.frame];
+	}
+
+	const unsigned int *generations;
+	int num_widths;
+	unsigned long references;
+	bool frames_agree;
+	vector<AddressField> index_fields;
+	vector<AddressField> tag_fields;
+	vector<StackEntry*> stacks;
+	vector<vector<unsigned long> > depth_counts;
+};
+
+class SimulatedGeometries : public GeometryMisses
+{
+public:
+	// every geometry simulated as its own LRU Cache, for the caches whose
+	// stacks lose the inclusion property: write-through caches, where a
+	// write reorders the stacks of the associativities it hits in but not
+	// the others, and lines larger than a page, which can hit from another
+	// frame (see StackDistanceProfile)
+	SimulatedGeometries(int max_sets, int offset_bits, int num_frames, const char *type, ReplacementStructure structure)
+	{
+		num_widths = __builtin_ctz(max_sets) + 1;
+		references = 0;
+		for (int w = 0; w < num_widths; ++w) {
+			for (int ways = 1; ways <= MAX_SET_SIZE; ++ways) {
+				caches.push_back(new Cache(1 << w, ways, num_frames, type, POLICY_LRU, ReplacementContext(0, structure)));
+				miss_counts.push_back(0);
+			}
+			index_fields.push_back(makeField(offset_bits, w));
+			tag_fields.push_back(makeField(offset_bits + w, MAX_TAG_BITS));
+		}
+	}
+	~SimulatedGeometries()
+	{
+		for (size_t i = 0; i < caches.size(); ++i) {
+			delete caches[i];
+		}
+	}
+	void access(uint64_t index_address, uint64_t tag_address, unsigned int frame, bool allocate)
+	{
+		++references;
+		for (size_t i = 0; i < caches.size(); ++i) {
+			unsigned int index = index_fields[i / MAX_SET_SIZE].extract(index_address);
+			uint64_t tag = tag_fields[i / MAX_SET_SIZE].extract(tag_address);
+			if (!caches[i]->readEntry(index, tag)) {
+				++miss_counts[i];
+				if (allocate) {
+					caches[i]->addEntry(index, tag, frame, 0);
+				}
+			}
+		}
+	}
+	void invalidateEntries(unsigned int frame)
+	{
+		for (size_t i = 0; i < caches.size(); ++i) {
+			caches[i]->invalidateEntries(frame);
+		}
+	}
+	unsigned long referenceCount()
+	{
+		return references;
+	}
+	unsigned long misses(int width, int ways)
+	{
+		return miss_counts[width * MAX_SET_SIZE + ways - 1];
+	}
+	int widths()
+	{
+		return num_widths;
+	}
+private:
+	int num_widths;
+	unsigned long references;
+	vector<Cache*> caches;
+	vector<unsigned long> miss_counts;
+	vector<AddressField> index_fields;
+	vector<AddressField> tag_fields;
+};
+
+class MissRatioAnalysis
+{
+public:
+	// translates the trace once, exactly like Hierarchy, and feeds each
+	// reference to the stack distance profiles of both caches and TLBs, or
+	// to every simulated geometry of a cache whose stacks are not exact. The
+	// frame a page lands in does not depend on the TLB or cache geometry, so
+	// one translation serves every geometry
+	MissRatioAnalysis(const Config& c) : config(c)
+	{
+		page_table = new PageTable(config.page_index_bits, config.physical_pages);
+		physical_pages = new FrameManager(config.physical_pages, config.frame_policy, ReplacementContext(config.replacement_seed, STRUCTURE_FRAMES));
+		generations = new unsigned int[config.physical_pages + 1]();
+		references = 0;
+		// a line larger than a page only loses its frame to another when page
+		// faults invalidate lines, that is when addresses are translated
+		bool invalidating = config.virtual_addresses_enabled;
+		if (invalidating && config.instruction_cache_offset_bits > config.page_offset_bits) {
+			instruction_cache = new SimulatedGeometries(MAX_CACHE_SETS, config.instruction_cache_offset_bits, config.physical_pages, "instruction", STRUCTURE_INSTRUCTION_CACHE);
+		} else {
+			instruction_cache = new StackDistanceProfile(MAX_CACHE_SETS, config.instruction_cache_offset_bits, generations);
+		}
+		if (config.data_cache_write_through || (invalidating && config.data_cache_offset_bits > config.page_offset_bits)) {
+			data_cache = new SimulatedGeometries(MAX_CACHE_SETS, config.data_cache_offset_bits, config.physical_pages, "data", STRUCTURE_DATA_CACHE);
+		} else {
+			data_cache = new StackDistanceProfile(MAX_CACHE_SETS, config.data_cache_offset_bits, generations);
+		}
+		instruction_tlb = new StackDistanceProfile(MAX_TLB_SETS, config.page_offset_bits, generations);
+		data_tlb = new StackDistanceProfile(MAX_TLB_SETS, config.page_offset_bits, generations);
+	}
+	~MissRatioAnalysis()
+	{
+		delete instruction_cache;
+		delete data_cache;
+		delete instruction_tlb;
+		delete data_tlb;
+		delete[] generations;
+		delete page_table;
+		delete physical_pages;
+	}
+	void analyze(const TraceRecord *records, size_t count)
+	{
+		for (size_t r = 0; r < count; ++r) {
+			// a coalesced record stands for its repeats as well
+			for (uint32_t i = 0; i <= records[r].repeats; ++i) {
+				analyzeReference(records[r]);
+			}
+		}
+	}
+	// the miss ratio of the LRU cache (or TLB with is_tlb) of 2^width sets
+	// and the given ways
+	double missRatio(bool is_instruction, bool is_tlb, int width, int ways)
+	{
+		GeometryMisses *misses = is_tlb ? (is_instruction ? instruction_tlb : data_tlb) : (is_instruction ? instruction_cache : data_cache);
+		unsigned long n = misses->referenceCount();
+		return (n > 0) ? (double)misses->misses(width, ways) / n : 0.0;
+	}
+	void printMissRatios()
+	{
+		printf("Miss ratios of every LRU geometry\n");
+		printTable("I-cache", config.instruction_cache_line_size, "byte lines", instruction_cache);
+		printTable("D-cache", config.data_cache_line_size, "byte lines", data_cache);
+		if (config.virtual_addresses_enabled) {
+			printTable("Instruction TLB", config.page_size, "byte pages", instruction_tlb);
+			printTable("Data TLB", config.page_size, "byte pages", data_tlb);
+		}
+	}
+private:
+	void analyzeReference(const TraceRecord& record)
+	{
+		bool is_instruction = (record.stream_type == 'I');
+		bool is_write = (record.access_type == 'W');
+		int hex_address_size = record.address_digits * 4;
+		uint64_t address_mask = (hex_address_size >= 64) ? UINT64_MAX : (1ull << hex_address_size) - 1;
+		uint64_t hex_address = record.address;
+		unsigned int physical_page_num;
+
+		++references;
+		if (is_write && is_instruction) {
+			throwError("write to an instruction in reference");
+		}
+		if (config.virtual_addresses_enabled) {
+			uint64_t virtual_page_num = config.virtual_page.extract(hex_address);
+			physical_page_num = page_table->readEntry(virtual_page_num);
+			if (physical_page_num < UINT_MAX) {
+				physical_pages->touch(physical_page_num);
+			} else {
+				physical_page_num = handlePageFault(virtual_page_num);
+			}
+			// a TLB hit always agrees with the page table, so every TLB
+			// geometry sees the same frame
+			(is_instruction ? instruction_tlb : data_tlb)->access(hex_address, hex_address, physical_page_num, true);
+			hex_address = (hex_address & ~(config.virtual_page.mask << config.virtual_page.shift)) | (static_cast<uint64_t>(physical_page_num) << config.page_offset_bits);
+		} else {
+			uint64_t frame = config.physical_page.extract(hex_address);
+			if (frame >= static_cast<uint64_t>(config.physical_pages)) {
+				throwError("address %llx is too large", static_cast<unsigned long long>(hex_address));
+			}
+			physical_page_num = frame;
+		}
+
+		if (is_instruction) {
+			instruction_cache->access(hex_address, hex_address & address_mask, physical_page_num, true);
+			if (config.virtual_addresses_enabled && !instruction_cache->framesAgree()) {
+				// the tag, cut to the digits of the address, lost page bits
+				throwError("trace reference %lu hits an I-cache line of another page, which -m cannot model; its address has too few digits", references);
+			}
+		} else {
+			data_cache->access(hex_address, hex_address, physical_page_num, !(config.data_cache_write_through && is_write));
+		}
+	}
+	unsigned int handlePageFault(uint64_t virtual_page_num)
+	{
+		// the frame choice and invalidations of Hierarchy::handlePageFault
+		unsigned int physical_page_num = physical_pages->victimFrame();
+		bool referenced_before = physical_pages->wasReferencedBefore(physical_page_num);
+		physical_pages->fill(physical_page_num);
+		if (referenced_before) {
+			page_table->invalidateEntries(physical_page_num);
+			++generations[physical_page_num];
+			instruction_cache->invalidateEntries(physical_page_num);
+			data_cache->invalidateEntries(physical_page_num);
+		}
+		page_table->addEntry(virtual_page_num, physical_page_num);
+		return physical_page_num;
+	}
+	void printTable(const char *name, int unit, const char *units, GeometryMisses *misses)
+	{
+		unsigned long n = misses->referenceCount();
+		printf("\n%s, %d-%s, %lu references\n\n%6s", name, unit, units, n, "sets");
+		for (int ways = 1; ways <= MAX_SET_SIZE; ++ways) {
+			printf("  %4d-way", ways);
+		}
+		printf("\n");
+		for (int w = 0; w < misses->widths(); ++w) {
+			printf("%6d", 1 << w);
+			for (int ways = 1; ways <= MAX_SET_SIZE; ++ways) {
+				printf("  %8.6f", (n > 0) ? (double)misses->misses(w, ways) / n : 0.0);
+			}
+			printf("\n");
+		}
+	}
+
+	const Config& config;
+	PageTable *page_table;
+	FrameManager *physical_pages;
+	unsigned int *generations;
+	unsigned long references;
+	GeometryMisses *instruction_cache;
+	GeometryMisses *data_cache;
+	GeometryMisses *instruction_tlb;
+	GeometryMisses *data_tlb;
+};
+
+void runMissRatioAnalysis(TraceReader*);
+
+#endif
@@ -0,0 +1,58 @@
+#include <cstdlib>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HIERARCHY_X86_SIMD
+#endif
+#include "cache.h"
+using namespace std;
+
+#ifdef HIERARCHY_X86_SIMD
+__attribute__((target("sse4.1")))
+unsigned int matchKeysSSE4(const uint64_t *keys, int n, uint64_t key, uint64_t mask)
+{
+	__m128i k = _mm_set1_epi64x(key);
+	__m128i m = _mm_set1_epi64x(mask);
+	unsigned int matches = 0;
+	int i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m128i v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), m);
+		matches |= static_cast<unsigned int>(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(v, k)))) << i;
+	}
+	return matches | (matchKeysScalar(keys + i, n - i, key, mask) << i);
+}
+
+__attribute__((target("avx2")))
+unsigned int matchKeysAVX2(const uint64_t *keys, int n, uint64_t key, uint64_t mask)
+{
+	__m256i k = _mm256_set1_epi64x(key);
+	__m256i m = _mm256_set1_epi64x(mask);
+	unsigned int matches = 0;
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256i v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), m);
+		matches |= static_cast<unsigned int>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, k)))) << i;
+	}
+	return matches | (matchKeysScalar(keys + i, n - i, key, mask) << i);
+}
+#endif
+
+MatchKernel selectMatchKernel()
+{
+	// the widest kernel the CPU supports, optionally capped through
+	// HIERARCHY_SIMD=scalar|sse4 to compare results across kernels
+	const char *cap = getenv("HIERARCHY_SIMD");
+	string limit = (cap != nullptr) ? cap : "";
+#ifdef HIERARCHY_X86_SIMD
+	__builtin_cpu_init();
+	if (limit != "scalar" && limit != "sse4" && __builtin_cpu_supports("avx2")) {
+		return matchKeysAVX2;
+	}
+	if (limit != "scalar" && __builtin_cpu_supports("sse4.1")) {
+		return matchKeysSSE4;
+	}
+#endif
+	return matchKeysScalar;
+}
+
+extern const MatchKernel matchKeysWide = selectMatchKernel();
@@ -0,0 +1,279 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include "checkpoint.h"
+#include "frames.h"
+#include "replacement.h"
+
+using namespace std;
+
+// Cache and TLB ways store their tag and valid bit packed into one 64-bit key
+// (valid bit above the 63 tag bits), so one compare per way checks both. The
+// match kernels compare all ways of a set at once and return a bitmask of the
+// ways whose masked key equals the search key.
+const uint64_t KEY_VALID = 1ull << 63;
+const uint64_t KEY_TAG = KEY_VALID - 1;
+const int MAX_TAG_BITS = 63;
+
+inline uint64_t makeKey(uint64_t tag, bool valid)
+{
+	return (valid ? KEY_VALID : 0) | tag;
+}
+
+typedef unsigned int (*MatchKernel)(const uint64_t*, int, uint64_t, uint64_t);
+
+inline unsigned int matchKeysScalar(const uint64_t *keys, int n, uint64_t key, uint64_t mask)
+{
+	unsigned int matches = 0;
+	for (int i = 0; i < n; ++i) {
+		if ((keys[i] & mask) == key) {
+			matches |= 1u << i;
+		}
+	}
+	return matches;
+}
+
+extern const MatchKernel matchKeysWide; // the widest kernel the CPU supports
+
+template <int WAYS>
+inline unsigned int matchKeys(const uint64_t *keys, int n, uint64_t key, uint64_t mask = ~0ull)
+{
+	// one or two ways are cheaper to compare inline than through the kernel
+	if ((WAYS != 0 && WAYS < 4) || n < 4) {
+		return matchKeysScalar(keys, n, key, mask);
+	}
+	return matchKeysWide(keys, n, key, mask);
+}
+
+class CacheSet
+{
+public:
+	// view of one set inside the contiguous storage owned by Cache; ways are
+	// addressed by index and the replacement state is one byte per way.
+	// WAYS is the associativity when known at compile time, 0 otherwise,
+	// and POLICY the replacement policy class (see replacement.h)
+	CacheSet(int n, uint64_t *k, unsigned int *p, unsigned char *d, unsigned char *r, ReplacementContext *c)
+	{
+		num_entries = n;
+		keys = k;
+		phys_page_nums = p;
+		dirty_bits = d;
+		replacement = r;
+		context = c;
+	}
+	template <int WAYS, class POLICY>
+	int readEntry(uint64_t tag)
+	{
+		// returns the way that hit, -1 on a miss
+		unsigned int matches = matchKeys<WAYS>(keys, ways<WAYS>(), makeKey(tag, true));
+		if (matches != 0) {
+			int way = __builtin_ctz(matches);
+			POLICY::hit(replacement, ways<WAYS>(), way);
+			return way;
+		}
+		return -1;
+	}
+	template <int WAYS>
+	bool containsEntry(uint64_t tag)
+	{
+		// a lookup that leaves the replacement state alone
+		return matchKeys<WAYS>(keys, ways<WAYS>(), makeKey(tag, true)) != 0;
+	}
+	template <int WAYS, class POLICY>
+	int addEntry(uint64_t tag, unsigned int phys_page_num, unsigned int dirty, bool& replaced_dirty, uint64_t& replaced_key)
+	{
+		int way = POLICY::victim(replacement, ways<WAYS>(), *context);
+		replaced_dirty = dirty_bits[way];
+		replaced_key = keys[way];
+		keys[way] = makeKey(tag, true);
+		dirty_bits[way] = dirty;
+		phys_page_nums[way] = phys_page_num;
+		POLICY::fill(replacement, ways<WAYS>(), way, *context);
+		return way; // way that was replaced
+	}
+	template <int WAYS = 0>
+	void updateDirtyEntry(uint64_t tag)
+	{
+		// matches on the tag alone, valid or not
+		unsigned int matches = matchKeys<WAYS>(keys, ways<WAYS>(), tag, KEY_TAG);
+		while (matches != 0) {
+			dirty_bits[__builtin_ctz(matches)] = 1;
+			matches &= matches - 1;
+		}
+	}
+private:
+	template <int WAYS>
+	int ways()
+	{
+		return (WAYS != 0) ? WAYS : num_entries;
+	}
+
+	int num_entries;
+	uint64_t *keys;
+	unsigned int *phys_page_nums;
+	unsigned char *dirty_bits;
+	unsigned char *replacement;
+	ReplacementContext *context;
+};
+
+class Cache
+{
+public:
+	Cache(int s, int ss, int num_frames, string t, ReplacementPolicy p, const ReplacementContext& c) : context(c)
+	{
+		num_sets = s;
+		set_size = ss;
+		type = t;
+		policy = p;
+		num_ways = num_sets * set_size;
+		// all ways of all sets live in one block, laid out field by field:
+		// tag/valid keys, physical page numbers, dirty bits, replacement state
+		block = new unsigned char[num_ways * BYTES_PER_WAY];
+		keys = reinterpret_cast<uint64_t*>(block);
+		phys_page_nums = reinterpret_cast<unsigned int*>(keys + num_ways);
+		dirty_bits = reinterpret_cast<unsigned char*>(phys_page_nums + num_ways);
+		replacement = dirty_bits + num_ways;
+		for (int i = 0; i < num_ways; ++i) {
+			keys[i] = makeKey(KEY_TAG, false);
+			phys_page_nums[i] = UINT_MAX;
+			dirty_bits[i] = 0;
+		}
+		for (int i = 0; i < num_sets; ++i) {
+			REPLACEMENT_DISPATCH(policy, POLICY::reset(replacement + i * set_size, set_size));
+		}
+		frame_lines = new FrameIndex(num_frames, num_ways);
+	}
+	~Cache()
+	{
+		delete frame_lines;
+		delete[] block;
+	}
+	template <int WAYS = 0>
+	bool readEntry(unsigned int index, uint64_t tag)
+	{
+		return findLine<WAYS>(index, tag) != UINT_MAX;
+	}
+	template <int WAYS = 0>
+	unsigned int findLine(unsigned int index, uint64_t tag)
+	{
+		// readEntry that returns the line (set * set_size + way) that hit,
+		// UINT_MAX on a miss
+		CacheSet s = set<WAYS>(index);
+		int way = -1;
+		REPLACEMENT_DISPATCH(policy, way = s.template readEntry<WAYS, POLICY>(tag));
+		return (way < 0) ? UINT_MAX : firstWay<WAYS>(index) + way;
+	}
+	template <int WAYS = 0>
+	bool containsEntry(unsigned int index, uint64_t tag)
+	{
+		return set<WAYS>(index).template containsEntry<WAYS>(tag);
+	}
+	template <int WAYS = 0>
+	bool addEntry(unsigned int index, uint64_t tag, unsigned int phys_page_num, unsigned int dirty)
+	{
+		// returns true if the line it replaced was dirty
+		bool replaced_dirty;
+		uint64_t replaced_key;
+		fillLine<WAYS>(index, tag, phys_page_num, dirty, replaced_dirty, replaced_key);
+		return replaced_dirty;
+	}
+	template <int WAYS = 0>
+	unsigned int fillLine(unsigned int index, uint64_t tag, unsigned int phys_page_num, unsigned int dirty, bool& replaced_dirty, uint64_t& replaced_key)
+	{
+		// addEntry that returns the line it filled and the key it replaced
+		CacheSet s = set<WAYS>(index);
+		unsigned int line = firstWay<WAYS>(index);
+		REPLACEMENT_DISPATCH(policy, line += s.template addEntry<WAYS, POLICY>(tag, phys_page_num, dirty, replaced_dirty, replaced_key));
+		frame_lines->link(line, phys_page_num);
+		return line;
+	}
+	int lines()
+	{
+		return num_ways;
+	}
+	void setDirty(unsigned int line)
+	{
+		dirty_bits[line] = 1;
+	}
+	int invalidateEntry(unsigned int index, uint64_t tag)
+	{
+		// drops one line without touching the replacement state; returns its
+		// dirty bit, -1 if the line was not in the cache
+		unsigned int matches = matchKeys<0>(keys + firstWay<0>(index), set_size, makeKey(tag, true));
+		if (matches == 0) {
+			return -1;
+		}
+		return invalidateLine(firstWay<0>(index) + __builtin_ctz(matches));
+	}
+	int invalidateLine(unsigned int line)
+	{
+		int dirty = dirty_bits[line];
+		keys[line] &= ~KEY_VALID;
+		dirty_bits[line] = 0;
+		return dirty;
+	}
+	template <int WAYS = 0>
+	void updateDirtyEntry(unsigned int index, uint64_t tag)
+	{
+		set<WAYS>(index).template updateDirtyEntry<WAYS>(tag);
+	}
+	int invalidateEntries(unsigned int phys_page_num)
+	{
+		// only lines filled from this frame are visited; invalidated lines stay
+		// chained until refilled since their page number is unchanged
+		int dirty_count = 0;
+		for (unsigned int line = frame_lines->first(phys_page_num); line != UINT_MAX; line = frame_lines->next(line)) {
+			keys[line] &= ~KEY_VALID;
+			if (dirty_bits[line] == 1) {
+				dirty_bits[line] = 0;
+				++dirty_count;
+			}
+		}
+		return dirty_count; // return number of invalidated dirty cache entries (need to write back to memory if write-back policy)
+	}
+	void save(CheckpointWriter& out)
+	{
+		// every way with its replacement state, then the frame chains
+		out.write(block, num_ways * BYTES_PER_WAY);
+		context.save(out);
+		frame_lines->save(out);
+	}
+	void restore(CheckpointReader& in)
+	{
+		in.read(block, num_ways * BYTES_PER_WAY);
+		context.restore(in);
+		frame_lines->restore(in);
+	}
+private:
+	static const size_t BYTES_PER_WAY = sizeof(uint64_t) + sizeof(unsigned int) + 2;
+
+	template <int WAYS>
+	unsigned int firstWay(unsigned int index)
+	{
+		return index * ((WAYS != 0) ? WAYS : set_size);
+	}
+	template <int WAYS>
+	CacheSet set(unsigned int index)
+	{
+		unsigned int first = firstWay<WAYS>(index);
+		return CacheSet(set_size, keys + first, phys_page_nums + first, dirty_bits + first, replacement + first, &context);
+	}
+
+	int num_sets;
+	int set_size;
+	int num_ways;
+	string type;
+	ReplacementPolicy policy;
+	ReplacementContext context;
+	unsigned char *block;
+	uint64_t *keys;
+	unsigned int *phys_page_nums;
+	unsigned char *dirty_bits;
+	unsigned char *replacement;
+	FrameIndex *frame_lines;
+};
+
+#endif
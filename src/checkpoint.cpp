@@ -0,0 +1,50 @@
+#include <cstring>
+#include "checkpoint.h"
+using namespace std;
+
+void checkpointGeometry(const Config& config, uint64_t *geometry)
+{
+	// the configuration values a checkpoint's state depends on, in file order
+	uint64_t values[CHECKPOINT_GEOMETRY_SIZE] = {
+		static_cast<uint64_t>(config.instruction_tlb_sets),
+		static_cast<uint64_t>(config.instruction_tlb_set_size),
+		static_cast<uint64_t>(config.data_tlb_sets),
+		static_cast<uint64_t>(config.data_tlb_set_size),
+		config.virtual_pages,
+		static_cast<uint64_t>(config.physical_pages),
+		static_cast<uint64_t>(config.page_size),
+		static_cast<uint64_t>(config.instruction_cache_sets),
+		static_cast<uint64_t>(config.instruction_cache_set_size),
+		static_cast<uint64_t>(config.instruction_cache_line_size),
+		static_cast<uint64_t>(config.data_cache_sets),
+		static_cast<uint64_t>(config.data_cache_set_size),
+		static_cast<uint64_t>(config.data_cache_line_size),
+		config.data_cache_write_through,
+		config.virtual_addresses_enabled,
+		config.tlbs_enabled,
+		config.instruction_tlb_policy,
+		config.data_tlb_policy,
+		config.frame_policy,
+		config.instruction_cache_policy,
+		config.data_cache_policy,
+		config.replacement_seed,
+		config.instruction_prefetcher,
+		config.data_prefetcher,
+		static_cast<uint64_t>(config.instruction_prefetch_degree),
+		static_cast<uint64_t>(config.data_prefetch_degree),
+		static_cast<uint64_t>(config.prefetch_latency),
+		static_cast<uint64_t>(config.lower_levels),
+		static_cast<uint64_t>(config.l1_hit_latency),
+		static_cast<uint64_t>(config.memory_latency),
+		static_cast<uint64_t>(config.write_buffer_entries),
+		static_cast<uint64_t>(config.write_buffer_age),
+	};
+	// then five values per lower level, zero for the unconfigured ones
+	uint64_t *level_values = values + CHECKPOINT_GEOMETRY_SIZE - 5 * MAX_LOWER_LEVELS;
+	for (int k = 0; k < MAX_LOWER_LEVELS; ++k) {
+		const LevelConfig& l = config.levels[k];
+		uint64_t level[5] = {static_cast<uint64_t>(l.sets), static_cast<uint64_t>(l.set_size), static_cast<uint64_t>(l.line_size), l.inclusion, static_cast<uint64_t>(l.hit_latency)};
+		memcpy(level_values + 5 * k, level, sizeof(level));
+	}
+	memcpy(geometry, values, sizeof(values));
+}
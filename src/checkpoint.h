@@ -0,0 +1,125 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "config.h"
+#include "error.h"
+
+using namespace std;
+
+// number of configuration values a checkpoint records, see checkpointGeometry
+const int CHECKPOINT_GEOMETRY_SIZE = 32 + 5 * MAX_LOWER_LEVELS;
+
+// header of a warm-state checkpoint; the state of every structure follows
+struct CheckpointFileHeader
+{
+	char magic[4]; // "HCKP"
+	uint32_t version;
+	uint64_t references; // trace references simulated before the checkpoint
+	uint64_t geometry[CHECKPOINT_GEOMETRY_SIZE]; // configuration the state belongs to
+};
+
+const uint32_t CHECKPOINT_FILE_VERSION = 7;
+
+void checkpointGeometry(const Config&, uint64_t*);
+
+class CheckpointWriter
+{
+public:
+	// sequential writer of the raw state blocks of a checkpoint file
+	CheckpointWriter(string f)
+	{
+		filename = f;
+		out = fopen(filename.c_str(), "wb");
+		if (out == nullptr) {
+			throwError("failed to open %s for writing", filename.c_str());
+		}
+	}
+	~CheckpointWriter()
+	{
+		if (out != nullptr) {
+			fclose(out); // abandoned by an error
+		}
+	}
+	void close()
+	{
+		// a destructor cannot report the error, so the saver closes the file;
+		// ferror catches a failed flush of an earlier write
+		bool failed = ferror(out) != 0;
+		failed = (fclose(out) != 0) || failed;
+		out = nullptr;
+		if (failed) {
+			throwError("failed to write checkpoint %s", filename.c_str());
+		}
+	}
+	void write(const void *data, size_t size)
+	{
+		if (fwrite(data, 1, size, out) < size) {
+			throwError("failed to write checkpoint %s", filename.c_str());
+		}
+	}
+private:
+	string filename;
+	FILE *out;
+};
+
+class CheckpointReader
+{
+public:
+	// bounds-checked cursor over a checkpoint file mapped into memory, so a
+	// restore is a series of memcpys straight out of the page cache
+	CheckpointReader(string f)
+	{
+		struct stat st;
+		filename = f;
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0 || fstat(fd, &st) < 0) {
+			if (fd >= 0) {
+				close(fd);
+			}
+			throwError("failed to open checkpoint %s", filename.c_str());
+		}
+		size = st.st_size;
+		map = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+		close(fd);
+		if (map == MAP_FAILED) {
+			throwError("failed to map checkpoint %s", filename.c_str());
+		}
+		next = static_cast<const char*>(map);
+		end = next + size;
+	}
+	~CheckpointReader()
+	{
+		if (map != nullptr) {
+			munmap(map, size);
+		}
+	}
+	void read(void *data, size_t n)
+	{
+		if (static_cast<size_t>(end - next) < n) {
+			throwError("checkpoint %s is truncated", filename.c_str());
+		}
+		memcpy(data, next, n);
+		next += n;
+	}
+	bool atEnd()
+	{
+		return next == end;
+	}
+private:
+	string filename;
+	void *map;
+	size_t size;
+	const char *next;
+	const char *end;
+};
+
+#endif
@@ -0,0 +1,572 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include "cache.h"
+#include "config.h"
+#include "error.h"
+using namespace std;
+
+bool isPowerOfTwo(uint64_t n)
+{
+	while (n > 1 && n % 2 == 0) {
+		n /= 2;
+	}
+	return (n == 1);
+}
+
+// the structures whose replacement policy trace.config can set, by name
+struct ReplacementSetting
+{
+	const char *name;
+	ReplacementPolicy Config::*policy;
+	const char *description; // as printed by printConfig
+};
+
+const ReplacementSetting REPLACEMENT_SETTINGS[] = {
+	{"Instruction TLB", &Config::instruction_tlb_policy, "instruction TLB"},
+	{"Data TLB", &Config::data_tlb_policy, "data TLB"},
+	{"Page frames", &Config::frame_policy, "page frame list"},
+	{"Instruction cache", &Config::instruction_cache_policy, "I-cache"},
+	{"Data cache", &Config::data_cache_policy, "D-cache"},
+};
+
+bool parseReplacementPolicy(const string& name, ReplacementPolicy& policy)
+{
+	for (int p = 0; p < NUM_REPLACEMENT_POLICIES; ++p) {
+		if (name == REPLACEMENT_POLICY_NAMES[p]) {
+			policy = static_cast<ReplacementPolicy>(p);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool parsePrefetcher(const string& value, PrefetcherKind& kind, int& degree)
+{
+	// a prefetcher name, optionally followed by its degree (1 by default)
+	size_t space = value.find_first_of(" \t");
+	string name = value.substr(0, space);
+	degree = 1;
+	if (space != string::npos) {
+		char *end;
+		string number = value.substr(value.find_first_not_of(" \t", space));
+		degree = strtol(number.c_str(), &end, 10);
+		if (*end != '\0') {
+			return false;
+		}
+	}
+	for (int k = 0; k < NUM_PREFETCHER_KINDS; ++k) {
+		if (name == PREFETCHER_NAMES[k]) {
+			kind = static_cast<PrefetcherKind>(k);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool parseInclusionPolicy(const string& name, InclusionPolicy& inclusion)
+{
+	for (int i = 0; i < NUM_INCLUSION_POLICIES; ++i) {
+		if (name == INCLUSION_POLICY_NAMES[i]) {
+			inclusion = static_cast<InclusionPolicy>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+// the keys of a "Level N cache configuration" section
+struct LevelSetting
+{
+	const char *name;
+	int LevelConfig::*value;
+};
+
+const LevelSetting LEVEL_SETTINGS[] = {
+	{"Number of sets", &LevelConfig::sets},
+	{"Set size", &LevelConfig::set_size},
+	{"Line size", &LevelConfig::line_size},
+	{"Hit latency", &LevelConfig::hit_latency},
+};
+
+const Config getConfig(string config_filename)
+{
+	Config config;
+	ifstream in_file;
+	string file_str;
+	char file_char;
+
+	in_file.open(config_filename.c_str());
+	if (!in_file.is_open()) {
+		throwError("failed to open configuration file %s", config_filename.c_str());
+	}
+
+	getline(in_file, file_str);
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.instruction_tlb_sets;
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.instruction_tlb_set_size;
+
+	getline(in_file, file_str);
+
+	getline(in_file, file_str);
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.data_tlb_sets;
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.data_tlb_set_size;
+
+	getline(in_file, file_str);
+
+	getline(in_file, file_str);
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.virtual_pages;
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.physical_pages;
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.page_size;
+
+	getline(in_file, file_str);
+
+	getline(in_file, file_str);
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.instruction_cache_sets;
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.instruction_cache_set_size;
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.instruction_cache_line_size;
+
+	getline(in_file, file_str);
+
+	getline(in_file, file_str);
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.data_cache_sets;
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.data_cache_set_size;
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	in_file >> config.data_cache_line_size;
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	file_char = in_file.get();
+	if (file_char == 'y') {
+		config.data_cache_write_through = 1;
+	} else if (file_char == 'n') {
+		config.data_cache_write_through = 0;
+	} else {
+		throwError("invalid value for write-through configuration");
+	}
+
+	getline(in_file, file_str);
+
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	file_char = in_file.get();
+	if (file_char == 'y') {
+		config.virtual_addresses_enabled = 1;
+	} else if (file_char == 'n') {
+		config.virtual_addresses_enabled = 0;
+	} else {
+		throwError("invalid value for virtual address configuration");
+	}
+
+	getline(in_file, file_str, ':');
+	in_file.ignore();
+	file_char = in_file.get();
+	if (file_char == 'y') {
+		config.tlbs_enabled = 1;
+	} else if (file_char == 'n') {
+		config.tlbs_enabled = 0;
+	} else {
+		throwError("invalid value for TLB configuration");
+	}
+
+	// an optional section may follow with lines such as "Data cache: srrip"
+	// (see REPLACEMENT_SETTINGS) or "Data prefetcher: stride 4", and the
+	// sections of the unified levels below the L1 caches, from "Level 2
+	// cache configuration" on (see LEVEL_SETTINGS); every structure not
+	// named uses LRU, no cache prefetches, the L1 caches are the last level
+	// and nothing buffers the writes to memory
+	config.instruction_tlb_policy = POLICY_LRU;
+	config.data_tlb_policy = POLICY_LRU;
+	config.frame_policy = POLICY_LRU;
+	config.instruction_cache_policy = POLICY_LRU;
+	config.data_cache_policy = POLICY_LRU;
+	config.replacement_seed = 0;
+	config.instruction_prefetcher = PREFETCH_NONE;
+	config.data_prefetcher = PREFETCH_NONE;
+	config.instruction_prefetch_degree = 1;
+	config.data_prefetch_degree = 1;
+	config.prefetch_latency = 0;
+	config.lower_levels = 0;
+	for (LevelConfig& l : config.levels) {
+		l.sets = 0;
+		l.set_size = 0;
+		l.line_size = 0;
+		l.inclusion = INCLUSION_NINE;
+		l.hit_latency = 0;
+	}
+	config.l1_hit_latency = 0;
+	config.memory_latency = 0;
+	config.write_buffer_entries = 0;
+	config.write_buffer_age = 0;
+	LevelConfig *level = nullptr; // of the level section being read
+	getline(in_file, file_str);
+	while (getline(in_file, file_str)) {
+		size_t colon = file_str.find(':');
+		if (colon == string::npos) {
+			if (file_str.compare(0, 6, "Level ") == 0 && file_str.find(" cache configuration") != string::npos) {
+				if (atoi(file_str.c_str() + 6) != config.lower_levels + 2 || config.lower_levels == MAX_LOWER_LEVELS) {
+					throwError("the lower cache levels must be levels 2 to %d, in order", MAX_LOWER_LEVELS + 1);
+				}
+				level = &config.levels[config.lower_levels++];
+			} else if (file_str.find_first_not_of(" \t\r") != string::npos) {
+				level = nullptr; // the title of another section
+			}
+			continue;
+		}
+		string name = file_str.substr(0, colon);
+		string value = file_str.substr(colon + 1);
+		value.erase(0, value.find_first_not_of(" \t"));
+		value.erase(value.find_last_not_of(" \t\r") + 1);
+		if (level != nullptr && name == "Inclusion") {
+			if (!parseInclusionPolicy(value, level->inclusion)) {
+				throwError("unknown inclusion policy %s", value.c_str());
+			}
+			continue;
+		}
+		const LevelSetting *level_setting = nullptr;
+		for (const LevelSetting& s : LEVEL_SETTINGS) {
+			if (level != nullptr && name == s.name) {
+				level_setting = &s;
+			}
+		}
+		int *setting_value = nullptr;
+		if (level_setting != nullptr) {
+			setting_value = &(level->*(level_setting->value));
+		} else if (name == "Level 1 hit latency") {
+			setting_value = &config.l1_hit_latency;
+		} else if (name == "Memory latency") {
+			setting_value = &config.memory_latency;
+		} else if (name == "Write buffer entries") {
+			setting_value = &config.write_buffer_entries;
+		} else if (name == "Write buffer age") {
+			setting_value = &config.write_buffer_age;
+		}
+		if (setting_value != nullptr) {
+			char *end;
+			long number = strtol(value.c_str(), &end, 10);
+			if (value.empty() || *end != '\0' || number < 0 || number > INT_MAX) {
+				throwError("invalid value for %s", name.c_str());
+			}
+			*setting_value = number;
+			continue;
+		}
+		if (name == "Random seed") {
+			char *end;
+			config.replacement_seed = strtoull(value.c_str(), &end, 10);
+			if (value.empty() || *end != '\0') {
+				throwError("invalid random seed %s", value.c_str());
+			}
+			continue;
+		}
+		if (name == "Instruction prefetcher" || name == "Data prefetcher") {
+			bool parsed = (name[0] == 'I') ? parsePrefetcher(value, config.instruction_prefetcher, config.instruction_prefetch_degree)
+					: parsePrefetcher(value, config.data_prefetcher, config.data_prefetch_degree);
+			if (!parsed) {
+				throwError("invalid prefetcher %s", value.c_str());
+			}
+			continue;
+		}
+		if (name == "Prefetch latency") {
+			char *end;
+			config.prefetch_latency = strtol(value.c_str(), &end, 10);
+			if (value.empty() || *end != '\0') {
+				throwError("invalid prefetch latency %s", value.c_str());
+			}
+			continue;
+		}
+		const ReplacementSetting *setting = nullptr;
+		for (const ReplacementSetting& s : REPLACEMENT_SETTINGS) {
+			if (name == s.name) {
+				setting = &s;
+			}
+		}
+		if (setting == nullptr) {
+			throwError("unknown configuration line %s", file_str.c_str());
+		}
+		if (!parseReplacementPolicy(value, config.*(setting->policy))) {
+			throwError("unknown replacement policy %s", value.c_str());
+		}
+	}
+
+	in_file.close();
+
+	return finishConfig(config);
+}
+
+const Config finishConfig(Config config)
+{
+	// validate the raw values, then derive the index/offset widths and address fields
+	if (config.instruction_tlb_sets < 1 || config.instruction_tlb_sets > 256) {
+		throwError("the number of instruction TLB sets must be between 1 and 256, inclusive");
+	}
+	if (!isPowerOfTwo(config.instruction_tlb_sets)) {
+		throwError("the number of instruction TLB sets must be a power of two");
+	}
+	if (config.instruction_tlb_set_size < 1 || config.instruction_tlb_set_size > 8) {
+		throwError("instruction TLB associativity must be between 1 and 8, inclusive");
+	}
+	if (config.data_tlb_sets < 1 || config.data_tlb_sets > 256) {
+		throwError("the number of data TLB sets must be between 1 and 256, inclusive");
+	}
+	if (!isPowerOfTwo(config.data_tlb_sets)) {
+		throwError("the number of data TLB sets must be a power of two");
+	}
+	if (config.data_tlb_set_size < 1 || config.data_tlb_set_size > 8) {
+		throwError("data TLB associativity must be between 1 and 8, inclusive");
+	}
+	if (!isPowerOfTwo(config.virtual_pages)) {
+		throwError("the number of virtual pages must be a power of two");
+	}
+	if (config.physical_pages < 0) {
+		throwError("the number of physical pages cannot be negative");
+	}
+	if (config.virtual_addresses_enabled && config.physical_pages < 1) {
+		throwError("virtual addresses need at least one physical page");
+	}
+	if (!isPowerOfTwo(config.page_size)) {
+		throwError("the page size must be a power of two");
+	}
+	if (__builtin_ctzll(config.virtual_pages) + __builtin_ctz(config.page_size) > 64) {
+		throwError("the virtual address space cannot be larger than 64 bits");
+	}
+	if (config.instruction_cache_sets < 1 || config.instruction_cache_sets > 8192) {
+		throwError("the number of instruction cache must be between 1 and 8192, inclusive");
+	}
+	if (!isPowerOfTwo(config.instruction_cache_sets)) {
+		throwError("the number of instruction cache sets must be a power of two");
+	}
+	if (config.instruction_cache_set_size < 1 || config.instruction_cache_set_size > 8) {
+		throwError("instruction cache associativity must be between 1 and 8");
+	}
+	if (config.instruction_cache_line_size < 4) {
+		throwError("the instruction cache line size must be at least 4");
+	}
+	if (!isPowerOfTwo(config.instruction_cache_line_size)) {
+		throwError("the instruction cache line size must be a power of two");
+	}
+	if (config.data_cache_sets < 1 || config.data_cache_sets > 8192) {
+		throwError("the number of data cache must be between 1 and 8192, inclusive");
+	}
+	if (!isPowerOfTwo(config.data_cache_sets)) {
+		throwError("the number of data cache sets must be a power of two");
+	}
+	if (config.data_cache_set_size < 1 || config.data_cache_set_size > 8) {
+		throwError("data cache associativity must be between 1 and 8, inclusive");
+	}
+	if (config.data_cache_line_size < 8) {
+		throwError("the data cache line size must be at least 8");
+	}
+	if (!isPowerOfTwo(config.data_cache_line_size)) {
+		throwError("the data cache line size must be a power of two");
+	}
+	if (config.tlbs_enabled && !config.virtual_addresses_enabled) {
+		throwError("TLBs cannot be enabled when virtual addresses are disabled");
+	}
+	for (const ReplacementSetting& s : REPLACEMENT_SETTINGS) {
+		if (config.*(s.policy) >= NUM_REPLACEMENT_POLICIES) {
+			throwError("invalid replacement policy for the %s", s.description);
+		}
+	}
+	if ((config.instruction_tlb_policy == POLICY_TREE_PLRU && !isPowerOfTwo(config.instruction_tlb_set_size))
+			|| (config.data_tlb_policy == POLICY_TREE_PLRU && !isPowerOfTwo(config.data_tlb_set_size))
+			|| (config.instruction_cache_policy == POLICY_TREE_PLRU && !isPowerOfTwo(config.instruction_cache_set_size))
+			|| (config.data_cache_policy == POLICY_TREE_PLRU && !isPowerOfTwo(config.data_cache_set_size))
+			|| (config.frame_policy == POLICY_TREE_PLRU && !isPowerOfTwo(config.physical_pages))) {
+		throwError("tree-plru replacement needs a power of two ways (physical pages for page frames)");
+	}
+	if (config.frame_policy != POLICY_LRU && config.frame_policy != POLICY_FIFO && config.physical_pages < 1) {
+		throwError("%s replacement of page frames needs at least one physical page", REPLACEMENT_POLICY_NAMES[config.frame_policy]);
+	}
+	if (config.instruction_prefetcher >= NUM_PREFETCHER_KINDS || config.data_prefetcher >= NUM_PREFETCHER_KINDS) {
+		throwError("invalid prefetcher");
+	}
+	if (config.instruction_prefetch_degree < 1 || config.instruction_prefetch_degree > MAX_PREFETCH_DEGREE
+			|| config.data_prefetch_degree < 1 || config.data_prefetch_degree > MAX_PREFETCH_DEGREE) {
+		throwError("the prefetch degree must be between 1 and %d", MAX_PREFETCH_DEGREE);
+	}
+	if (config.prefetch_latency < 0) {
+		throwError("the prefetch latency cannot be negative");
+	}
+	if (config.lower_levels < 0 || config.lower_levels > MAX_LOWER_LEVELS) {
+		throwError("there can be at most %d cache levels below the L1 caches", MAX_LOWER_LEVELS);
+	}
+	for (int k = config.lower_levels; k < MAX_LOWER_LEVELS; ++k) {
+		if (config.levels[k].sets != 0) {
+			throwError("the level %d cache is not configured", k + 2);
+		}
+	}
+	for (int k = 0; k < config.lower_levels; ++k) {
+		const LevelConfig& level = config.levels[k];
+		// the line above: the larger L1 line, or the level above's
+		int above_line_size = (k == 0) ? max(config.instruction_cache_line_size, config.data_cache_line_size) : config.levels[k - 1].line_size;
+		if (level.sets < 1 || level.sets > MAX_LEVEL_SETS || !isPowerOfTwo(level.sets)) {
+			throwError("the number of level %d cache sets must be a power of two between 1 and %d", k + 2, MAX_LEVEL_SETS);
+		}
+		if (level.set_size < 1 || level.set_size > MAX_LEVEL_SET_SIZE) {
+			throwError("level %d cache associativity must be between 1 and %d", k + 2, MAX_LEVEL_SET_SIZE);
+		}
+		if (!isPowerOfTwo(level.line_size) || level.line_size < above_line_size) {
+			throwError("the level %d cache line size must be a power of two, at least the line size of the levels above", k + 2);
+		}
+		if (level.inclusion >= NUM_INCLUSION_POLICIES) {
+			throwError("invalid inclusion policy for the level %d cache", k + 2);
+		}
+		if (level.inclusion == INCLUSION_EXCLUSIVE && (level.line_size != config.instruction_cache_line_size || level.line_size != config.data_cache_line_size
+				|| (k > 0 && level.line_size != config.levels[k - 1].line_size))) {
+			throwError("an exclusive level %d cache needs the line size of every level above", k + 2);
+		}
+		if (level.hit_latency < 0) {
+			throwError("the level %d cache hit latency cannot be negative", k + 2);
+		}
+	}
+	if (config.l1_hit_latency < 0 || config.memory_latency < 0) {
+		throwError("latencies cannot be negative");
+	}
+	if (config.write_buffer_entries < 0 || config.write_buffer_entries > MAX_WRITE_BUFFER_ENTRIES || config.write_buffer_age < 0) {
+		throwError("the write buffer can have at most %d entries and cannot have a negative age", MAX_WRITE_BUFFER_ENTRIES);
+	}
+
+	config.instruction_tlb_index_bits = log2(config.instruction_tlb_sets);
+	config.data_tlb_index_bits = log2(config.data_tlb_sets);
+	config.page_index_bits = __builtin_ctzll(config.virtual_pages);
+	config.page_offset_bits = log2(config.page_size);
+	config.instruction_cache_index_bits = log2(config.instruction_cache_sets);
+	config.instruction_cache_offset_bits = log2(config.instruction_cache_line_size);
+	config.data_cache_index_bits = log2(config.data_cache_sets);
+	config.data_cache_offset_bits = log2(config.data_cache_line_size);
+	for (int k = 0; k < config.lower_levels; ++k) {
+		config.levels[k].index_bits = log2(config.levels[k].sets);
+		config.levels[k].offset_bits = log2(config.levels[k].line_size);
+	}
+	config.write_buffer_offset_bits = (config.lower_levels > 0) ? config.levels[config.lower_levels - 1].offset_bits : config.data_cache_offset_bits;
+
+	decodeAddressFields(config);
+	return config;
+}
+
+void decodeAddressFields(Config& config)
+{
+	config.page_offset = makeField(0, config.page_offset_bits);
+	config.virtual_page = makeField(config.page_offset_bits, config.page_index_bits);
+	config.physical_page = makeField(config.page_offset_bits, 64);
+	config.instruction_tlb_index = makeField(config.page_offset_bits, config.instruction_tlb_index_bits);
+	config.instruction_tlb_tag = makeField(config.page_offset_bits + config.instruction_tlb_index_bits, MAX_TAG_BITS);
+	config.data_tlb_index = makeField(config.page_offset_bits, config.data_tlb_index_bits);
+	config.data_tlb_tag = makeField(config.page_offset_bits + config.data_tlb_index_bits, MAX_TAG_BITS);
+	config.instruction_cache_index = makeField(config.instruction_cache_offset_bits, config.instruction_cache_index_bits);
+	config.instruction_cache_tag = makeField(config.instruction_cache_offset_bits + config.instruction_cache_index_bits, MAX_TAG_BITS);
+	config.data_cache_index = makeField(config.data_cache_offset_bits, config.data_cache_index_bits);
+	config.data_cache_tag = makeField(config.data_cache_offset_bits + config.data_cache_index_bits, MAX_TAG_BITS);
+	for (int k = 0; k < config.lower_levels; ++k) {
+		config.levels[k].index = makeField(config.levels[k].offset_bits, config.levels[k].index_bits);
+		config.levels[k].tag = makeField(config.levels[k].offset_bits + config.levels[k].index_bits, MAX_TAG_BITS);
+	}
+}
+
+void printConfig(const Config& config)
+{
+	printf("Instruction TLB contains %d sets.\nEach set contains %d entries.\nNumber of bits used for the index is %d.\n\n", config.instruction_tlb_sets, config.instruction_tlb_set_size, config.instruction_tlb_index_bits);
+	printf("Data TLB contains %d sets.\nEach set contains %d entries.\nNumber of bits used for the index is %d.\n\n", config.data_tlb_sets, config.data_tlb_set_size, config.data_tlb_index_bits);
+	printf("Number of virtual pages is %llu.\nNumber of physical pages is %d.\nEach page contains %d bytes.\nNumber of bits used for the page table index is %d.\nNumber of bits used for the page offset is %d.\n\n", static_cast<unsigned long long>(config.virtual_pages), config.physical_pages, config.page_size, config.page_index_bits, config.page_offset_bits);
+	printf("I-cache contains %d sets.\nEach set contains %d entries.\nEach line is %d bytes.\nNumber of bits used for the index is %d.\nNumber of bits used for the offset is %d.\n\n", config.instruction_cache_sets, config.instruction_cache_set_size, config.instruction_cache_line_size, config.instruction_cache_index_bits, config.instruction_cache_offset_bits);
+	printf("D-cache contains %d sets.\nEach set contains %d entries.\nEach line is %d bytes.\n", config.data_cache_sets, config.data_cache_set_size, config.data_cache_line_size);
+	if (config.data_cache_write_through) {
+		printf("The cache uses a no write-allocate and write-through policy.\n");
+	} else {
+		printf("The cache uses a write-allocate and write-back policy.\n");
+	}
+	printf("Number of bits used for the index is %d.\nNumber of bits used for the offset is %d.\n\n", config.data_cache_index_bits, config.data_cache_offset_bits);
+
+	if (config.virtual_addresses_enabled) {
+		printf("The addresses read in are virtual addresses.\n");
+	} else {
+		printf("The addresses read in are physical addresses.\n");
+	}
+
+	if (!config.tlbs_enabled) {
+		printf("TLBs are disabled in this configuration.\n");
+	}
+
+	bool random = false;
+	for (const ReplacementSetting& s : REPLACEMENT_SETTINGS) {
+		if (config.*(s.policy) != POLICY_LRU) {
+			printf("The %s uses %s replacement.\n", s.description, REPLACEMENT_POLICY_NAMES[config.*(s.policy)]);
+		}
+		random = random || (config.*(s.policy) == POLICY_RANDOM) || (config.*(s.policy) == POLICY_BRRIP);
+	}
+	if (random && config.replacement_seed != 0) {
+		printf("The random seed of replacement is %llu.\n", static_cast<unsigned long long>(config.replacement_seed));
+	}
+
+	if (config.instruction_prefetcher != PREFETCH_NONE) {
+		printf("The I-cache has a %s prefetcher of degree %d.\n", PREFETCHER_NAMES[config.instruction_prefetcher], config.instruction_prefetch_degree);
+	}
+	if (config.data_prefetcher != PREFETCH_NONE) {
+		printf("The D-cache has a %s prefetcher of degree %d.\n", PREFETCHER_NAMES[config.data_prefetcher], config.data_prefetch_degree);
+	}
+	if ((config.instruction_prefetcher != PREFETCH_NONE || config.data_prefetcher != PREFETCH_NONE) && config.prefetch_latency != 0) {
+		printf("A prefetch arrives %d references after it is issued.\n", config.prefetch_latency);
+	}
+
+	static const char *inclusion_descriptions[NUM_INCLUSION_POLICIES] = {"non-inclusive non-exclusive", "inclusive", "exclusive"};
+	for (int k = 0; k < config.lower_levels; ++k) {
+		const LevelConfig& level = config.levels[k];
+		printf("\nThe level %d cache is %s with %d sets of %d ways and %d-byte lines.\n", k + 2, inclusion_descriptions[level.inclusion], level.sets, level.set_size, level.line_size);
+		printf("Number of bits used for the level %d index is %d.\nNumber of bits used for the level %d offset is %d.\n", k + 2, level.index_bits, k + 2, level.offset_bits);
+	}
+	if (config.lower_levels > 0 || config.memory_latency > 0) {
+		printf("\nA hit takes %d cycles in the L1 caches", config.l1_hit_latency);
+		for (int k = 0; k < config.lower_levels; ++k) {
+			printf(", %d in level %d", config.levels[k].hit_latency, k + 2);
+		}
+		printf(" and a memory access %d cycles.\n", config.memory_latency);
+	}
+	if (config.write_buffer_entries > 0) {
+		printf("\nA write buffer of %d %d-byte lines stands in front of memory", config.write_buffer_entries, 1 << config.write_buffer_offset_bits);
+		if (config.write_buffer_age > 0) {
+			printf(", draining each line %d references after its first write", config.write_buffer_age);
+		}
+		printf(".\n");
+	}
+}
+
+AddressField makeField(int low_bit, int width)
+{
+	// field of width bits starting at low_bit; bits beyond 63 read as zero
+	AddressField field;
+	if (low_bit >= 64) {
+		field.shift = 0;
+		field.mask = 0;
+	} else {
+		field.shift = low_bit;
+		field.mask = (width >= 64) ? UINT64_MAX : (1ull << width) - 1;
+	}
+	return field;
+}
@@ -0,0 +1,167 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// bit field of an address, decoded once from the configuration so that the
+// per-reference path only has to shift and mask
+struct AddressField
+{
+	int shift;
+	uint64_t mask;
+	uint64_t extract(uint64_t address) const
+	{
+		return (address >> shift) & mask;
+	}
+};
+
+enum ReplacementPolicy : uint8_t
+{
+	POLICY_LRU,
+	POLICY_TREE_PLRU,
+	POLICY_BIT_PLRU,
+	POLICY_SRRIP,
+	POLICY_BRRIP,
+	POLICY_FIFO,
+	POLICY_RANDOM,
+	NUM_REPLACEMENT_POLICIES
+};
+
+// names as written in trace.config and printed by printConfig
+const char *const REPLACEMENT_POLICY_NAMES[NUM_REPLACEMENT_POLICIES] = {"lru", "tree-plru", "bit-plru", "srrip", "brrip", "fifo", "random"};
+
+enum PrefetcherKind : uint8_t
+{
+	PREFETCH_NONE,
+	PREFETCH_NEXT_LINE,
+	PREFETCH_STRIDE,
+	PREFETCH_STREAM,
+	NUM_PREFETCHER_KINDS
+};
+
+const char *const PREFETCHER_NAMES[NUM_PREFETCHER_KINDS] = {"none", "next-line", "stride", "stream"};
+
+// how a unified lower cache level relates to the levels above it:
+// inclusive levels hold every line above them (evicting one invalidates its
+// copies above), exclusive ones only the victims of the level above (a hit
+// moves the line up), and NINE (non-inclusive non-exclusive) levels fill on
+// every miss and evict independently
+enum InclusionPolicy : uint8_t
+{
+	INCLUSION_NINE,
+	INCLUSION_INCLUSIVE,
+	INCLUSION_EXCLUSIVE,
+	NUM_INCLUSION_POLICIES
+};
+
+const char *const INCLUSION_POLICY_NAMES[NUM_INCLUSION_POLICIES] = {"nine", "inclusive", "exclusive"};
+
+// a unified cache below the split level 1 caches, with its address fields
+struct LevelConfig
+{
+	int sets;
+	int set_size;
+	int line_size;
+	InclusionPolicy inclusion;
+	int hit_latency; // cycles
+	int index_bits;
+	int offset_bits;
+	AddressField index;
+	AddressField tag;
+};
+
+const int MAX_LOWER_LEVELS = 3; // levels 2 to 4
+
+struct Config
+{
+	int instruction_tlb_sets;
+	int instruction_tlb_set_size;
+	int instruction_tlb_index_bits;
+	int data_tlb_sets;
+	int data_tlb_set_size;
+	int data_tlb_index_bits;
+	uint64_t virtual_pages;
+	int physical_pages;
+	int page_size;
+	int page_index_bits;
+	int page_offset_bits;
+	int instruction_cache_sets;
+	int instruction_cache_set_size;
+	int instruction_cache_line_size;
+	int instruction_cache_index_bits;
+	int instruction_cache_offset_bits;
+	int data_cache_sets;
+	int data_cache_set_size;
+	int data_cache_line_size;
+	int data_cache_index_bits;
+	int data_cache_offset_bits;
+	bool data_cache_write_through;
+	bool virtual_addresses_enabled;
+	bool tlbs_enabled;
+	// replacement policies (see replacement.h), LRU unless trace.config
+	// names another, and the seed of the random policy
+	ReplacementPolicy instruction_tlb_policy;
+	ReplacementPolicy data_tlb_policy;
+	ReplacementPolicy frame_policy;
+	ReplacementPolicy instruction_cache_policy;
+	ReplacementPolicy data_cache_policy;
+	uint64_t replacement_seed;
+	// hardware prefetchers of the caches (see prefetch.h), none unless
+	// trace.config names one, and the references a prefetch takes to arrive
+	PrefetcherKind instruction_prefetcher;
+	PrefetcherKind data_prefetcher;
+	int instruction_prefetch_degree;
+	int data_prefetch_degree;
+	int prefetch_latency;
+	// unified cache levels below the L1 caches, none unless trace.config
+	// describes them, and the latencies of the average memory access time
+	int lower_levels;
+	LevelConfig levels[MAX_LOWER_LEVELS];
+	int l1_hit_latency;
+	int memory_latency;
+	// write buffer in front of memory, none unless trace.config gives it
+	// entries, combining writes to a line for up to write_buffer_age
+	// references (0 = until its space is needed)
+	int write_buffer_entries;
+	int write_buffer_age;
+	int write_buffer_offset_bits; // of the lines it holds, those of the last cache level
+
+	// address fields derived from the values above
+	AddressField page_offset;
+	AddressField virtual_page;
+	AddressField physical_page;
+	AddressField instruction_tlb_index;
+	AddressField instruction_tlb_tag;
+	AddressField data_tlb_index;
+	AddressField data_tlb_tag;
+	AddressField instruction_cache_index;
+	AddressField instruction_cache_tag;
+	AddressField data_cache_index;
+	AddressField data_cache_tag;
+};
+
+// the largest geometries a configuration accepts, which are also the
+// geometries a miss ratio analysis (-m) covers
+const int MAX_SET_SIZE = 8;
+const int MAX_CACHE_SETS = 8192;
+const int MAX_TLB_SETS = 256;
+const int MAX_PREFETCH_DEGREE = 16;
+const int MAX_LEVEL_SETS = 1 << 20;
+const int MAX_LEVEL_SET_SIZE = 32;
+const int MAX_WRITE_BUFFER_ENTRIES = 64;
+
+bool isPowerOfTwo(uint64_t);
+bool parseReplacementPolicy(const string&, ReplacementPolicy&);
+bool parsePrefetcher(const string&, PrefetcherKind&, int&);
+bool parseInclusionPolicy(const string&, InclusionPolicy&);
+// both throw a HierarchyError on a bad configuration
+const Config getConfig(string);
+const Config finishConfig(Config);
+void decodeAddressFields(Config&);
+AddressField makeField(int, int);
+void printConfig(const Config&);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef ERROR_H
+#define ERROR_H
+
+#include <cstdarg>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// A bad configuration, trace or state file. The library may run inside the
+// process that feeds it references, so it throws this instead of exiting;
+// main.cpp prints the message after "hierarchy: " and exits.
+class HierarchyError : public runtime_error
+{
+public:
+	HierarchyError(const string& message) : runtime_error(message)
+	{
+	}
+};
+
+// throws a HierarchyError with a printf-style message
+[[noreturn]] __attribute__((format(printf, 1, 2))) inline void throwError(const char *format, ...)
+{
+	char message[1024];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+	throw HierarchyError(message);
+}
+
+#endif
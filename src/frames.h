@@ -0,0 +1,228 @@
+#ifndef FRAMES_H
+#define FRAMES_H
+
+#include <climits>
+#include "checkpoint.h"
+#include "replacement.h"
+
+using namespace std;
+
+class FrameIndex
+{
+public:
+	// reverse map from a physical frame to the storage slots (cache lines or TLB
+	// entries, numbered set * set_size + way) whose page number is that frame,
+	// kept as one intrusive doubly linked chain per frame
+	FrameIndex(int f, int s)
+	{
+		num_frames = f;
+		num_slots = s;
+		heads = new unsigned int[num_frames];
+		next_slots = new unsigned int[num_slots];
+		prev_slots = new unsigned int[num_slots];
+		slot_frames = new unsigned int[num_slots];
+		for (unsigned int i = 0; i < num_frames; ++i) {
+			heads[i] = UINT_MAX;
+		}
+		for (unsigned int i = 0; i < num_slots; ++i) {
+			slot_frames[i] = UINT_MAX;
+		}
+	}
+	~FrameIndex()
+	{
+		delete[] heads;
+		delete[] next_slots;
+		delete[] prev_slots;
+		delete[] slot_frames;
+	}
+	void link(unsigned int slot, unsigned int frame)
+	{
+		unlink(slot);
+		if (frame >= num_frames) {
+			return;
+		}
+		slot_frames[slot] = frame;
+		prev_slots[slot] = UINT_MAX;
+		next_slots[slot] = heads[frame];
+		if (heads[frame] != UINT_MAX) {
+			prev_slots[heads[frame]] = slot;
+		}
+		heads[frame] = slot;
+	}
+	void unlink(unsigned int slot)
+	{
+		unsigned int frame = slot_frames[slot];
+		if (frame == UINT_MAX) {
+			return;
+		}
+		if (prev_slots[slot] != UINT_MAX) {
+			next_slots[prev_slots[slot]] = next_slots[slot];
+		} else {
+			heads[frame] = next_slots[slot];
+		}
+		if (next_slots[slot] != UINT_MAX) {
+			prev_slots[next_slots[slot]] = prev_slots[slot];
+		}
+		slot_frames[slot] = UINT_MAX;
+	}
+	unsigned int first(unsigned int frame)
+	{
+		return (frame < num_frames) ? heads[frame] : UINT_MAX;
+	}
+	unsigned int next(unsigned int slot)
+	{
+		return next_slots[slot];
+	}
+	void save(CheckpointWriter& out)
+	{
+		out.write(heads, num_frames * sizeof(unsigned int));
+		out.write(next_slots, num_slots * sizeof(unsigned int));
+		out.write(prev_slots, num_slots * sizeof(unsigned int));
+		out.write(slot_frames, num_slots * sizeof(unsigned int));
+	}
+	void restore(CheckpointReader& in)
+	{
+		in.read(heads, num_frames * sizeof(unsigned int));
+		in.read(next_slots, num_slots * sizeof(unsigned int));
+		in.read(prev_slots, num_slots * sizeof(unsigned int));
+		in.read(slot_frames, num_slots * sizeof(unsigned int));
+	}
+private:
+	unsigned int num_frames;
+	unsigned int num_slots;
+	unsigned int *heads;
+	unsigned int *next_slots;
+	unsigned int *prev_slots;
+	unsigned int *slot_frames;
+};
+
+class PhysicalPage
+{
+public:
+	// links of the intrusive LRU list, by frame number
+	unsigned int prev;
+	unsigned int next;
+	bool modified;
+	bool referenced_before;
+};
+
+class FrameManager
+{
+public:
+	FrameManager(int n, ReplacementPolicy p, const ReplacementContext& c) : context(c)
+	{
+		// frames are indexed by their page number; slot num_frames is the list head,
+		// its next is the LRU frame and its prev the most recently used one
+		num_frames = n;
+		policy = p;
+		frames = new PhysicalPage[num_frames + 1];
+		for (unsigned int i = 0; i <= num_frames; ++i) {
+			frames[i].prev = (i == 0) ? num_frames : i - 1;
+			frames[i].next = (i == num_frames) ? 0 : i + 1;
+			frames[i].modified = false;
+			frames[i].referenced_before = false;
+		}
+		// LRU and FIFO order the frames by the list, the other policies keep
+		// a state byte per frame like the ways of a set and only choose among
+		// frames once every frame has been used
+		replacement = nullptr;
+		next_unused = 0;
+		if (!usesList()) {
+			replacement = new unsigned char[num_frames];
+			REPLACEMENT_DISPATCH(policy, POLICY::reset(replacement, num_frames));
+		}
+	}
+	~FrameManager()
+	{
+		delete[] frames;
+		delete[] replacement;
+	}
+	unsigned int victimFrame()
+	{
+		// the frame a page fault fills, chosen once per fault
+		if (usesList()) {
+			return frames[num_frames].next;
+		}
+		if (next_unused < num_frames) {
+			return next_unused++;
+		}
+		REPLACEMENT_DISPATCH(policy, return POLICY::victim(replacement, num_frames, context));
+	}
+	void touch(unsigned int page_num)
+	{
+		// mark frame as used by a reference to its resident page
+		frames[page_num].referenced_before = true;
+		if (policy == POLICY_LRU) {
+			moveToBack(page_num);
+		} else if (!usesList()) {
+			REPLACEMENT_DISPATCH(policy, POLICY::hit(replacement, num_frames, page_num));
+		}
+	}
+	void fill(unsigned int page_num)
+	{
+		// mark frame as used by the page a fault brought in
+		frames[page_num].referenced_before = true;
+		if (usesList()) {
+			moveToBack(page_num);
+		} else {
+			REPLACEMENT_DISPATCH(policy, POLICY::fill(replacement, num_frames, page_num, context));
+		}
+	}
+	void setModified(unsigned int page_num, bool m)
+	{
+		frames[page_num].modified = m;
+	}
+	bool wasModified(unsigned int page_num)
+	{
+		return frames[page_num].modified;
+	}
+	bool wasReferencedBefore(unsigned int page_num)
+	{
+		return frames[page_num].referenced_before;
+	}
+	void save(CheckpointWriter& out)
+	{
+		// the LRU links with the modified and referenced bits, list head included,
+		// then the state of the other policies
+		out.write(frames, (num_frames + 1) * sizeof(PhysicalPage));
+		if (replacement != nullptr) {
+			out.write(replacement, num_frames);
+		}
+		out.write(&next_unused, sizeof(next_unused));
+		context.save(out);
+	}
+	void restore(CheckpointReader& in)
+	{
+		in.read(frames, (num_frames + 1) * sizeof(PhysicalPage));
+		if (replacement != nullptr) {
+			in.read(replacement, num_frames);
+		}
+		in.read(&next_unused, sizeof(next_unused));
+		context.restore(in);
+	}
+private:
+	bool usesList()
+	{
+		return policy == POLICY_LRU || policy == POLICY_FIFO;
+	}
+	void moveToBack(unsigned int page_num)
+	{
+		// move the frame to the end of the queue
+		PhysicalPage& p = frames[page_num];
+		frames[p.prev].next = p.next;
+		frames[p.next].prev = p.prev;
+		p.prev = frames[num_frames].prev;
+		p.next = num_frames;
+		frames[p.prev].next = page_num;
+		frames[num_frames].prev = page_num;
+	}
+
+	unsigned int num_frames;
+	ReplacementPolicy policy;
+	ReplacementContext context;
+	PhysicalPage *frames;
+	unsigned char *replacement;
+	unsigned int next_unused;
+};
+
+#endif
@@ -0,0 +1,1041 @@
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "cache.h"
+#include "checkpoint.h"
+#include "config.h"
+#include "error.h"
+#include "frames.h"
+#include "levels.h"
+#include "page_table.h"
+#include "prefetch.h"
+#include "profile.h"
+#include "report.h"
+#include "sampling.h"
+#include "shards.h"
+#include "statistics.h"
+#include "tlb.h"
+#include "trace.h"
+#include "translated.h"
+
+using namespace std;
+
+enum KernelMode
+{
+	KERNEL_EXACT,
+	KERNEL_SAMPLED,
+	KERNEL_SHARDED
+};
+
+// The simulated memory hierarchy of one configuration. A program embedding
+// the simulator gets a Config from getConfig, or fills in its raw values and
+// calls finishConfig, then feeds references through access or accessMany and
+// reads the counters from statistics(); main.cpp drives it from a trace.
+// Errors throw a HierarchyError, after which the Hierarchy is not usable.
+// CMakeLists.txt builds every source but main.cpp into the hierarchy
+// library, which main.cpp links as the command line tool.
+class Hierarchy
+{
+public:
+	Hierarchy(const Config& c, int rate = 1, int threads = 1) : config(c)
+	{
+		// with more than one thread an unsampled run splits the caches into
+		// shards, as many as the smaller cache has sets and the threads allow
+		// (a power of two); random and BRRIP caches draw from one generator
+		// per cache in reference order, prefetchers and the levels below the
+		// L1 caches fill the sets of other shards and the write buffer orders
+		// the writes of all of them, so none can be sharded
+		bool prefetching = config.instruction_prefetcher != PREFETCH_NONE || config.data_prefetcher != PREFETCH_NONE;
+		bool ordered_policy = config.instruction_cache_policy == POLICY_RANDOM || config.instruction_cache_policy == POLICY_BRRIP
+				|| config.data_cache_policy == POLICY_RANDOM || config.data_cache_policy == POLICY_BRRIP;
+		if (rate > 1 && prefetching) {
+			throwError("prefetchers fill lines outside the sampled sets, they cannot be sampled");
+		}
+		if (rate > 1 && config.lower_levels > 0) {
+			throwError("the levels below the L1 caches see every miss, they cannot be sampled");
+		}
+		if (rate > 1 && config.write_buffer_entries > 0) {
+			throwError("the write buffer combines writes of every set, it cannot be sampled");
+		}
+		int num_shards = (rate > 1 || ordered_policy || prefetching || config.lower_levels > 0 || config.write_buffer_entries > 0) ? 1 : min(threads, min(config.instruction_cache_sets, config.data_cache_sets));
+		while (!isPowerOfTwo(num_shards)) {
+			num_shards &= num_shards - 1;
+		}
+		if (num_shards > 1) {
+			shards = new CacheShards(config, num_shards);
+		} else {
+			instruction_cache = new Cache(config.instruction_cache_sets, config.instruction_cache_set_size, config.physical_pages, "instruction", config.instruction_cache_policy, ReplacementContext(config.replacement_seed, STRUCTURE_INSTRUCTION_CACHE));
+			data_cache = new Cache(config.data_cache_sets, config.data_cache_set_size, config.physical_pages, "data", config.data_cache_policy, ReplacementContext(config.replacement_seed, STRUCTURE_DATA_CACHE));
+		}
+		page_table = new PageTable(config.page_index_bits, config.physical_pages);
+		instruction_tlb = new TLB(config.instruction_tlb_sets, config.instruction_tlb_set_size, config.physical_pages, "instruction", config.instruction_tlb_policy, ReplacementContext(config.replacement_seed, STRUCTURE_INSTRUCTION_TLB));
+		data_tlb = new TLB(config.data_tlb_sets, config.data_tlb_set_size, config.physical_pages, "data", config.data_tlb_policy, ReplacementContext(config.replacement_seed, STRUCTURE_DATA_TLB));
+		physical_pages = new FrameManager(config.physical_pages, config.frame_policy, ReplacementContext(config.replacement_seed, STRUCTURE_FRAMES));
+		if (config.instruction_prefetcher != PREFETCH_NONE) {
+			instruction_prefetcher = new Prefetcher(config.instruction_prefetcher, config.instruction_prefetch_degree, max(0, config.page_offset_bits - config.instruction_cache_offset_bits), instruction_cache->lines(), config.prefetch_latency);
+		}
+		if (config.data_prefetcher != PREFETCH_NONE) {
+			data_prefetcher = new Prefetcher(config.data_prefetcher, config.data_prefetch_degree, max(0, config.page_offset_bits - config.data_cache_offset_bits), data_cache->lines(), config.prefetch_latency);
+		}
+		if (config.write_buffer_entries > 0) {
+			write_buffer = new WriteBuffer(config, &stats);
+		}
+		if (config.lower_levels > 0) {
+			levels = new CacheLevels(config, instruction_cache, data_cache, &stats, write_buffer);
+		}
+		memset(&stats, 0, sizeof(stats));
+		forgetMemos();
+		memo_tlb_fills[0] = fillLeavesHitState(config.data_tlb_policy);
+		memo_tlb_fills[1] = fillLeavesHitState(config.instruction_tlb_policy);
+		// an inclusive level may take back any L1 line when it fills
+		bool back_invalidates = false;
+		for (int k = 0; k < config.lower_levels; ++k) {
+			back_invalidates = back_invalidates || config.levels[k].inclusion == INCLUSION_INCLUSIVE;
+		}
+		memo_cache_hits[0] = (data_prefetcher == nullptr) && !back_invalidates;
+		memo_cache_hits[1] = (instruction_prefetcher == nullptr) && !back_invalidates;
+		memo_cache_fills[0] = memo_cache_hits[0] && fillLeavesHitState(config.data_cache_policy);
+		memo_cache_fills[1] = memo_cache_hits[1] && fillLeavesHitState(config.instruction_cache_policy);
+		sample_rate = rate;
+		if (sample_rate > 1) {
+			instruction_cache_sample = new SetSample(config.instruction_cache_sets, sample_rate);
+			data_cache_sample = new SetSample(config.data_cache_sets, sample_rate);
+			instruction_tlb_sample = new SetSample(config.instruction_tlb_sets, sample_rate);
+			data_tlb_sample = new SetSample(config.data_tlb_sets, sample_rate);
+		}
+		kernel = selectKernel();
+		replay_kernel = selectReplayKernel();
+	}
+	~Hierarchy()
+	{
+		delete instruction_cache;
+		delete data_cache;
+		delete page_table;
+		delete instruction_tlb;
+		delete data_tlb;
+		delete physical_pages;
+		delete instruction_cache_sample;
+		delete data_cache_sample;
+		delete instruction_tlb_sample;
+		delete data_tlb_sample;
+		delete shards;
+		delete instruction_prefetcher;
+		delete data_prefetcher;
+		delete levels;
+		delete write_buffer;
+	}
+	void simulate(const TraceRecord *records, size_t count, ReportWriter *report)
+	{
+		(this->*kernel)(records, count, report);
+		if (shards != nullptr) {
+			PROFILE_START(profile, shards_timer);
+			shards->run(stats, report);
+			PROFILE_STOP(profile, shards_timer, STAGE_CACHE, 0); // the kernel counted the references
+		}
+	}
+	void access(char stream_type, char access_type, uint64_t address)
+	{
+		// one reference ('I' or 'D', 'R' or 'W'), without a trace in between
+		TraceRecord record;
+		record.address = address;
+		record.stream_type = stream_type;
+		record.access_type = access_type;
+		record.address_digits = hexDigits(address);
+		record.reserved = 0;
+		record.repeats = 0;
+		simulate(&record, 1, nullptr);
+	}
+	void accessMany(const TraceRecord *records, size_t count)
+	{
+		simulate(records, count, nullptr);
+	}
+	void recordTranslation(TranslatedTraceWriter *writer)
+	{
+		// also write every translated reference and page eviction to writer
+		translated_trace = writer;
+	}
+	void replay(const TranslatedRecord *records, size_t count)
+	{
+		// simulates the caches alone on a translated trace recorded with the
+		// same TLB and page configuration; not for sampled or sharded runs
+		(this->*replay_kernel)(records, count);
+	}
+	const Statistics& statistics()
+	{
+		if (sample_rate > 1) {
+			estimateStatistics();
+			return estimate;
+		}
+		return stats;
+	}
+#ifdef HIERARCHY_PROFILE
+	Profiler& profiler()
+	{
+		return profile;
+	}
+#endif
+	void printProfile()
+	{
+		// where the time of this run went, in a HIERARCHY_PROFILE build
+#ifdef HIERARCHY_PROFILE
+		profile.print(stats.inst_refs + stats.data_refs - restored_references);
+#endif
+	}
+	void printSampling()
+	{
+		// confidence intervals of the hit ratios a sampled run estimated
+		if (sample_rate == 1) {
+			return;
+		}
+		printf("\nSet sampling (95%% confidence intervals)\n\n");
+		if (config.tlbs_enabled) {
+			printSampleInterval("itlb hit ratio", instruction_tlb_sample);
+			printSampleInterval("dtlb hit ratio", data_tlb_sample);
+		}
+		printSampleInterval("ic hit ratio", instruction_cache_sample);
+		printSampleInterval("dc hit ratio", data_cache_sample);
+	}
+	void saveCheckpoint(string filename, unsigned long long references)
+	{
+		// the complete warm state after the given number of trace references
+		checkCheckpointable();
+		CheckpointWriter out(filename);
+		CheckpointFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "HCKP", 4);
+		header.version = CHECKPOINT_FILE_VERSION;
+		header.references = references;
+		checkpointGeometry(config, header.geometry);
+		out.write(&header, sizeof(header));
+		out.write(&stats, sizeof(stats));
+		instruction_cache->save(out);
+		data_cache->save(out);
+		page_table->save(out);
+		instruction_tlb->save(out);
+		data_tlb->save(out);
+		physical_pages->save(out);
+		if (instruction_prefetcher != nullptr) {
+			instruction_prefetcher->save(out);
+		}
+		if (data_prefetcher != nullptr) {
+			data_prefetcher->save(out);
+		}
+		if (levels != nullptr) {
+			levels->save(out);
+		}
+		if (write_buffer != nullptr) {
+			write_buffer->save(out);
+		}
+		out.close();
+	}
+	unsigned long long restoreCheckpoint(string filename)
+	{
+		// returns the number of trace references the checkpoint had simulated
+		checkCheckpointable();
+		CheckpointReader in(filename);
+		CheckpointFileHeader header;
+		uint64_t geometry[CHECKPOINT_GEOMETRY_SIZE];
+		in.read(&header, sizeof(header));
+		if (memcmp(header.magic, "HCKP", 4) != 0 || header.version != CHECKPOINT_FILE_VERSION) {
+			throwError("%s is not a version %u checkpoint", filename.c_str(), CHECKPOINT_FILE_VERSION);
+		}
+		checkpointGeometry(config, geometry);
+		if (memcmp(header.geometry, geometry, sizeof(geometry)) != 0) {
+			throwError("checkpoint %s was taken with a different configuration", filename.c_str());
+		}
+		in.read(&stats, sizeof(stats));
+		instruction_cache->restore(in);
+		data_cache->restore(in);
+		page_table->restore(in);
+		instruction_tlb->restore(in);
+		data_tlb->restore(in);
+		physical_pages->restore(in);
+		if (instruction_prefetcher != nullptr) {
+			instruction_prefetcher->restore(in);
+		}
+		if (data_prefetcher != nullptr) {
+			data_prefetcher->restore(in);
+		}
+		if (levels != nullptr) {
+			levels->restore(in);
+		}
+		if (write_buffer != nullptr) {
+			write_buffer->restore(in);
+		}
+		forgetMemos();
+		restored_references = stats.inst_refs + stats.data_refs;
+		if (!in.atEnd()) {
+			throwError("checkpoint %s has trailing data", filename.c_str());
+		}
+		return header.references;
+	}
+private:
+	void checkCheckpointable()
+	{
+		// sharded caches live in the shards and sampled counters are only
+		// estimates, so a checkpoint holds the state of an exact, serial run
+		if (shards != nullptr || sample_rate > 1) {
+			throwError("checkpoints need an unsampled Hierarchy on one thread");
+		}
+	}
+
+	typedef void (Hierarchy::*Kernel)(const TraceRecord*, size_t, ReportWriter*);
+	typedef void (Hierarchy::*ReplayKernel)(const TranslatedRecord*, size_t);
+
+	// the last translation and cache line of one reference stream
+	struct StreamMemo
+	{
+		bool translation_valid;
+		uint64_t page_key; // address bits above the page offset
+		unsigned int physical_page_num;
+		bool page_dirty; // the page table dirty bit is already set
+		bool line_valid;
+		unsigned int cache_index;
+		uint64_t cache_tag;
+		bool line_dirty; // updateDirtyEntry already ran on the line
+	};
+
+	// The policy flags and the associativities are template parameters so that
+	// each common configuration gets a kernel without dead branches and with
+	// fully unrolled set searches. A way count of 0 is the generic fallback
+	// that reads the associativity at run time. SAMPLED kernels skip the TLB
+	// and cache sets outside their SetSample and count per sampled set.
+	// SHARDED kernels only translate and queue the cache accesses and their
+	// report rows for CacheShards.
+	template <bool VIRTUAL, bool TLBS, bool WRITE_THROUGH, int CACHE_WAYS, int TLB_WAYS, KernelMode MODE>
+	void simulateKernel(const TraceRecord *records, size_t count, ReportWriter *report)
+	{
+		ReferenceReport row;
+
+		for (size_t r = 0; r < count; ++r) {
+			simulateReference<VIRTUAL, TLBS, WRITE_THROUGH, CACHE_WAYS, TLB_WAYS, MODE>(records[r], report, row);
+			if (records[r].repeats != 0) {
+				repeatReference<VIRTUAL, TLBS, WRITE_THROUGH, CACHE_WAYS, TLB_WAYS, MODE>(records[r], report, row);
+			}
+		}
+	}
+	// A reference to the page, respectively the line, of its stream's last
+	// reference takes the memoized frame or hit instead of searching the TLB
+	// and page table or the cache set. Only the stream itself uses its TLB and
+	// cache, so the memoized way is still the MRU one and the search would
+	// change no replacement state; page evictions forget every memo. Under
+	// policies whose fill differs from a hit (RRIP) only a hit is memoized,
+	// and a cache with a prefetcher, which fills other lines of the set and
+	// trains on every access, memoizes no line at all.
+	// Sampled kernels keep no memos, sharded ones only the translation.
+	template <bool VIRTUAL, bool TLBS, bool WRITE_THROUGH, int CACHE_WAYS, int TLB_WAYS, KernelMode MODE>
+	void simulateReference(const TraceRecord& record, ReportWriter *report, ReferenceReport& row)
+	{
+		const bool SAMPLED = (MODE == KERNEL_SAMPLED);
+		const bool SHARDED = (MODE == KERNEL_SHARDED);
+		const bool TRANSLATION_MEMO = !SAMPLED;
+		const bool LINE_MEMO = (MODE == KERNEL_EXACT);
+		uint64_t hex_address;
+		int hex_address_size;
+		uint64_t address_mask;
+		uint64_t virtual_page_num = 0;
+		uint64_t page_offset;
+		uint64_t page_key = 0;
+		uint64_t tlb_tag = 0;
+		unsigned int tlb_index = 0;
+		AccessResult tlb_ref = RESULT_NONE;
+		AccessResult pt_ref = RESULT_NONE;
+		unsigned int physical_page_num = 0;
+		uint64_t cache_tag;
+		unsigned int cache_index;
+		AccessResult cache_ref;
+		unsigned long long memory_refs_before;
+
+		bool is_instruction = (record.stream_type == 'I');
+		bool is_write = (record.access_type == 'W');
+		StreamMemo& memo = memos[is_instruction ? 1 : 0];
+		if (is_write) {
+			++stats.writes;
+			if (is_instruction) {
+				if (SHARDED) {
+					shards->run(stats, report);
+				}
+				if (report != nullptr) {
+					report->flush();
+				}
+				throwError("write to an instruction in reference");
+			}
+		} else {
+			++stats.reads;
+		}
+		hex_address_size = record.address_digits * 4;
+		address_mask = (hex_address_size >= 64) ? UINT64_MAX : (1ull << hex_address_size) - 1;
+		hex_address = record.address;
+
+		page_offset = config.page_offset.extract(hex_address);
+		if (VIRTUAL) {
+			virtual_page_num = config.virtual_page.extract(hex_address);
+			page_key = hex_address >> config.page_offset_bits;
+		} else {
+			uint64_t frame = config.physical_page.extract(hex_address);
+			if (frame >= static_cast<uint64_t>(config.physical_pages)) { // Physical pages are 0 ... n-1, so physical page number cannot be >= n
+				if (SHARDED) {
+					shards->run(stats, report);
+				}
+				if (report != nullptr) {
+					report->flush();
+				}
+				throwError("address %llx is too large", static_cast<unsigned long long>(hex_address));
+			}
+			physical_page_num = frame;
+		}
+
+		if (is_instruction) {
+			++stats.inst_refs;
+		} else {
+			++stats.data_refs;
+		}
+
+		if (VIRTUAL) {
+			bool need_to_visit_pt = true;
+			TLB *tlb = is_instruction ? instruction_tlb : data_tlb;
+			SetSample *tlb_sample;
+			if (TLBS) {
+				if (is_instruction) {
+					tlb_index = config.instruction_tlb_index.extract(hex_address);
+					tlb_tag = config.instruction_tlb_tag.extract(hex_address);
+				} else {
+					tlb_index = config.data_tlb_index.extract(hex_address);
+					tlb_tag = config.data_tlb_tag.extract(hex_address);
+				}
+			}
+			PROFILE_START(profile, tlb_timer);
+			if (TRANSLATION_MEMO && memo.translation_valid && memo.page_key == page_key) {
+				// same page as the last reference of the stream
+				physical_page_num = memo.physical_page_num;
+				if (TLBS) {
+					tlb_ref = RESULT_HIT;
+					++(is_instruction ? stats.itlb_hits : stats.dtlb_hits);
+					pt_ref = RESULT_NONE;
+				} else {
+					++stats.memory_refs;
+					pt_ref = RESULT_HIT;
+					++stats.pt_hits;
+				}
+				physical_pages->touch(physical_page_num);
+				PROFILE_STOP(profile, tlb_timer, TLBS ? STAGE_TLB : STAGE_PAGE_TABLE, 1);
+			} else {
+				if (TLBS) {
+					tlb_sample = is_instruction ? instruction_tlb_sample : data_tlb_sample;
+					if (SAMPLED && !tlb_sample->contains(tlb_index)) {
+						// set not sampled, translate through the page table alone
+						tlb_ref = RESULT_NONE;
+					} else {
+						physical_page_num = tlb->readEntry<TLB_WAYS>(tlb_index, tlb_tag);
+						if (physical_page_num < UINT_MAX) { // TLB hit
+							tlb_ref = RESULT_HIT;
+							++(is_instruction ? stats.itlb_hits : stats.dtlb_hits);
+							pt_ref = RESULT_NONE;
+							need_to_visit_pt = false;
+							physical_pages->touch(physical_page_num); // move page frame to end of queue
+						} else { // TLB miss, need to go to page table
+							tlb_ref = RESULT_MISS;
+							++(is_instruction ? stats.itlb_misses : stats.dtlb_misses);
+						}
+						if (SAMPLED) {
+							tlb_sample->count(tlb_index, tlb_ref == RESULT_MISS, 0);
+						}
+					}
+					PROFILE_STOP(profile, tlb_timer, STAGE_TLB, 1);
+				}
+
+				PROFILE_START(profile, page_table_timer);
+				if (need_to_visit_pt) {
+					++stats.memory_refs;
+					physical_page_num = page_table->readEntry(virtual_page_num);
+					if (physical_page_num < UINT_MAX) { // Page table hit
+						pt_ref = RESULT_HIT;
+						++stats.pt_hits;
+						physical_pages->touch(physical_page_num); // move page frame to end of queue
+					} else { // Page table fault (miss), go to disk, bring page into LRU frame
+						pt_ref = RESULT_MISS;
+						physical_page_num = handlePageFault(virtual_page_num);
+					}
+					if (TLBS && (!SAMPLED || tlb_ref != RESULT_NONE)) {
+						tlb->addEntry<TLB_WAYS>(tlb_index, tlb_tag, physical_page_num); // update TLB
+					}
+				}
+				PROFILE_STOP(profile, page_table_timer, STAGE_PAGE_TABLE, need_to_visit_pt ? 1 : 0);
+				if (TRANSLATION_MEMO) {
+					memo.translation_valid = !TLBS || tlb_ref == RESULT_HIT || memo_tlb_fills[is_instruction ? 1 : 0];
+					memo.page_key = page_key;
+					memo.physical_page_num = physical_page_num;
+					memo.page_dirty = false;
+				}
+			}
+			// replace virtual page number with acquired physical page number
+			// first clear virtual page number bits by negating the page field mask and anding it with the hex address
+			// then substitute the physical page number by shifting the value and oring it with the result of the and operation
+			hex_address = (hex_address & ~(config.virtual_page.mask << config.virtual_page.shift)) | (static_cast<uint64_t>(physical_page_num) << config.page_offset_bits);
+		}
+		if (translated_trace != nullptr) {
+			PROFILE_START(profile, translated_timer);
+			translated_trace->writeReference(record, hex_address, physical_page_num, tlb_ref, pt_ref);
+			PROFILE_STOP(profile, translated_timer, STAGE_OUTPUT, 1);
+		}
+
+		PROFILE_START(profile, cache_timer);
+		if (is_instruction) {
+			cache_index = config.instruction_cache_index.extract(hex_address);
+			cache_tag = config.instruction_cache_tag.extract(hex_address & address_mask);
+			if (SHARDED) {
+				cache_ref = RESULT_NONE; // filled in by CacheShards::run
+				shards->queueAccess(SHARD_INSTRUCTION, cache_index, cache_tag, physical_page_num);
+			} else if (SAMPLED && !instruction_cache_sample->contains(cache_index)) {
+				cache_ref = RESULT_NONE;
+			} else if (LINE_MEMO && memo.line_valid && memo.cache_index == cache_index && memo.cache_tag == cache_tag) {
+				++stats.ic_hits;
+				cache_ref = RESULT_HIT;
+			} else {
+				cache_ref = accessInstructionCache<CACHE_WAYS>(cache_index, cache_tag, physical_page_num);
+				if (LINE_MEMO) {
+					memo.line_valid = (cache_ref == RESULT_HIT) ? memo_cache_hits[1] : memo_cache_fills[1];
+					memo.cache_index = cache_index;
+					memo.cache_tag = cache_tag;
+				}
+			}
+			if (SAMPLED && cache_ref != RESULT_NONE) {
+				instruction_cache_sample->count(cache_index, cache_ref == RESULT_MISS, (cache_ref == RESULT_MISS) ? 1 : 0);
+			}
+		} else {
+			if (is_write) { // writing to page (only occurs for data references)
+				physical_pages->setModified(physical_page_num, true);
+				if (!TRANSLATION_MEMO || !VIRTUAL || !memo.page_dirty) {
+					page_table->setPageDirtyBit(physical_page_num); // update the dirty bit for corresponding entries
+					memo.page_dirty = VIRTUAL;
+				}
+			}
+
+			cache_index = config.data_cache_index.extract(hex_address);
+			cache_tag = config.data_cache_tag.extract(hex_address);
+			memory_refs_before = stats.memory_refs;
+			if (SHARDED) {
+				cache_ref = RESULT_NONE;
+				shards->queueAccess(is_write ? SHARD_WRITE : SHARD_READ, cache_index, cache_tag, physical_page_num);
+			} else if (SAMPLED && !data_cache_sample->contains(cache_index)) {
+				cache_ref = RESULT_NONE;
+			} else if (LINE_MEMO && memo.line_valid && memo.cache_index == cache_index && memo.cache_tag == cache_tag) {
+				++stats.dc_hits;
+				cache_ref = RESULT_HIT;
+				if (is_write) {
+					if (WRITE_THROUGH) {
+						countWriteThrough(1, cache_index, cache_tag);
+					} else if (!memo.line_dirty) {
+						data_cache->updateDirtyEntry<CACHE_WAYS>(cache_index, cache_tag);
+						memo.line_dirty = true;
+					}
+				}
+			} else {
+				cache_ref = accessDataCache<WRITE_THROUGH, CACHE_WAYS>(cache_index, cache_tag, physical_page_num, is_write);
+				if (LINE_MEMO) {
+					// a write-through write miss leaves the line out of the cache
+					memo.line_valid = (cache_ref == RESULT_HIT) ? memo_cache_hits[0] : (memo_cache_fills[0] && !(WRITE_THROUGH && is_write));
+					memo.cache_index = cache_index;
+					memo.cache_tag = cache_tag;
+					memo.line_dirty = (!WRITE_THROUGH && is_write && cache_ref == RESULT_HIT);
+				}
+			}
+			if (SAMPLED && cache_ref != RESULT_NONE) {
+				data_cache_sample->count(cache_index, cache_ref == RESULT_MISS, stats.memory_refs - memory_refs_before);
+			}
+		}
+		PROFILE_STOP(profile, cache_timer, STAGE_CACHE, 1);
+
+		if (report != nullptr) {
+			PROFILE_START(profile, output_timer);
+			row.address = record.address;
+			row.virtual_page_num = virtual_page_num;
+			row.page_offset = page_offset;
+			row.tlb_tag = tlb_tag;
+			row.tlb_index = tlb_index;
+			row.physical_page_num = physical_page_num;
+			row.cache_tag = cache_tag;
+			row.cache_index = cache_index;
+			row.stream_type = record.stream_type;
+			row.tlb_result = tlb_ref;
+			row.pt_result = pt_ref;
+			row.cache_result = cache_ref;
+			if (SHARDED) {
+				shards->queueRow(row);
+			} else {
+				report->writeReference(row);
+			}
+			PROFILE_STOP(profile, output_timer, STAGE_OUTPUT, 1);
+		}
+	}
+	// the rest of a run-length coalesced record: once its first reference
+	// left the page and line memoized, every repeat hits in the TLB (or page
+	// table) and the cache, and nothing but the counters and the frame's
+	// replacement state changes
+	template <bool VIRTUAL, bool TLBS, bool WRITE_THROUGH, int CACHE_WAYS, int TLB_WAYS, KernelMode MODE>
+	void repeatReference(const TraceRecord& record, ReportWriter *report, ReferenceReport& row)
+	{
+		bool is_instruction = (record.stream_type == 'I');
+		bool is_write = (record.access_type == 'W');
+		StreamMemo& memo = memos[is_instruction ? 1 : 0];
+		unsigned long long n = record.repeats;
+
+		if (MODE != KERNEL_EXACT || report != nullptr || translated_trace != nullptr || !memo.line_valid || (VIRTUAL && !memo.translation_valid)) {
+			// every repeat needs its own output or its own cache access
+			for (uint32_t i = 0; i < record.repeats; ++i) {
+				simulateReference<VIRTUAL, TLBS, WRITE_THROUGH, CACHE_WAYS, TLB_WAYS, MODE>(record, report, row);
+			}
+			return;
+		}
+		stats.reads += is_write ? 0 : n;
+		stats.writes += is_write ? n : 0;
+		if (is_instruction) {
+			stats.inst_refs += n;
+			stats.ic_hits += n;
+		} else {
+			stats.data_refs += n;
+			stats.dc_hits += n;
+			if (is_write) {
+				if (WRITE_THROUGH) {
+					countWriteThrough(n, memo.cache_index, memo.cache_tag);
+				} else if (!memo.line_dirty) {
+					data_cache->updateDirtyEntry<CACHE_WAYS>(memo.cache_index, memo.cache_tag);
+					memo.line_dirty = true;
+				}
+			}
+		}
+		if (VIRTUAL) {
+			physical_pages->touch(memo.physical_page_num);
+		}
+		if (VIRTUAL && TLBS) {
+			(is_instruction ? stats.itlb_hits : stats.dtlb_hits) += n;
+		} else if (VIRTUAL) {
+			stats.memory_refs += n;
+			stats.pt_hits += n;
+		}
+	}
+	// the replay of a translated trace: the caches see the recorded physical
+	// addresses and evictions, the translation counters come from the
+	// recorded TLB and page table results
+	template <bool WRITE_THROUGH, int CACHE_WAYS>
+	void replayKernel(const TranslatedRecord *records, size_t count)
+	{
+		for (size_t r = 0; r < count; ++r) {
+			const TranslatedRecord& record = records[r];
+			if (record.stream_type == 'E') {
+				if (record.access_type == 'W') {
+					++stats.disk_refs;
+				}
+				PROFILE_START(profile, invalidation_timer);
+				invalidateCaches(record.physical_page_num);
+				PROFILE_STOP(profile, invalidation_timer, STAGE_INVALIDATION, 1);
+				continue;
+			}
+			bool is_instruction = (record.stream_type == 'I');
+			bool is_write = (record.access_type == 'W');
+			AccessResult tlb_ref = static_cast<AccessResult>(record.results & 3);
+			AccessResult pt_ref = static_cast<AccessResult>(record.results >> 2);
+			++(is_write ? stats.writes : stats.reads);
+			++(is_instruction ? stats.inst_refs : stats.data_refs);
+			if (tlb_ref == RESULT_HIT) {
+				++(is_instruction ? stats.itlb_hits : stats.dtlb_hits);
+			} else if (tlb_ref == RESULT_MISS) {
+				++(is_instruction ? stats.itlb_misses : stats.dtlb_misses);
+			}
+			if (pt_ref != RESULT_NONE) {
+				++stats.memory_refs;
+				if (pt_ref == RESULT_HIT) {
+					++stats.pt_hits;
+				} else {
+					++stats.pt_faults;
+					++stats.disk_refs;
+				}
+			}
+			PROFILE_START(profile, cache_timer);
+			if (is_instruction) {
+				int hex_address_size = record.address_digits * 4;
+				uint64_t address_mask = (hex_address_size >= 64) ? UINT64_MAX : (1ull << hex_address_size) - 1;
+				accessInstructionCache<CACHE_WAYS>(config.instruction_cache_index.extract(record.address), config.instruction_cache_tag.extract(record.address & address_mask), record.physical_page_num);
+			} else {
+				accessDataCache<WRITE_THROUGH, CACHE_WAYS>(config.data_cache_index.extract(record.address), config.data_cache_tag.extract(record.address), record.physical_page_num, is_write);
+			}
+			PROFILE_STOP(profile, cache_timer, STAGE_CACHE, 1);
+		}
+	}
+	template <int CACHE_WAYS>
+	AccessResult accessInstructionCache(unsigned int cache_index, uint64_t cache_tag, unsigned int physical_page_num)
+	{
+		unsigned int line = instruction_cache->findLine<CACHE_WAYS>(cache_index, cache_tag);
+		if (line != UINT_MAX) {
+			++stats.ic_hits;
+			if (instruction_prefetcher != nullptr) {
+				prefetch<CACHE_WAYS>(true, cache_index, cache_tag, line, false, physical_page_num);
+			}
+			return RESULT_HIT;
+		}
+		++stats.ic_misses;
+		// bring in from memory, update cache
+		uint64_t replaced_key;
+		line = fetchLine<CACHE_WAYS>(true, cache_index, cache_tag, physical_page_num, false, true, replaced_key);
+		if (instruction_prefetcher != nullptr) {
+			prefetch<CACHE_WAYS>(true, cache_index, cache_tag, line, true, physical_page_num);
+		}
+		return RESULT_MISS;
+	}
+	template <bool WRITE_THROUGH, int CACHE_WAYS>
+	AccessResult accessDataCache(unsigned int cache_index, uint64_t cache_tag, unsigned int physical_page_num, bool is_write)
+	{
+		unsigned int line = data_cache->findLine<CACHE_WAYS>(cache_index, cache_tag);
+		if (line != UINT_MAX) {
+			++stats.dc_hits;
+			if (WRITE_THROUGH) { // write-through, no-write allocate
+				if (is_write) {
+					// update cache, access and update next level of memory hierarchy
+					countWriteThrough(1, cache_index, cache_tag);
+				}
+			} else { // write-back, write allocate
+				if (is_write) {
+					// update cache (set dirty bit)
+					data_cache->updateDirtyEntry<CACHE_WAYS>(cache_index, cache_tag);
+				}
+			}
+			if (data_prefetcher != nullptr) {
+				prefetch<CACHE_WAYS>(false, cache_index, cache_tag, line, false, physical_page_num);
+			}
+			return RESULT_HIT;
+		}
+		++stats.dc_misses;
+		uint64_t replaced_key;
+		if (WRITE_THROUGH) { // write-through, no-write allocate
+			// writes only access and update next level of memory hierarchy,
+			// reads bring the line in from memory and update the cache
+			if (is_write) {
+				countWriteThrough(1, cache_index, cache_tag);
+			} else {
+				line = fetchLine<CACHE_WAYS>(false, cache_index, cache_tag, physical_page_num, false, true, replaced_key);
+			}
+		} else { // write-back, write allocate
+			// update cache (dirty on a write)
+			line = fetchLine<CACHE_WAYS>(false, cache_index, cache_tag, physical_page_num, is_write, true, replaced_key);
+		}
+		if (data_prefetcher != nullptr) {
+			prefetch<CACHE_WAYS>(false, cache_index, cache_tag, line, true, physical_page_num);
+		}
+		return RESULT_MISS;
+	}
+	// after a demand access that reached a cache with a prefetcher: count the
+	// prefetches it used or found evicted and install the lines the
+	// prefetcher asks for (line is the cache line that hit or was filled,
+	// UINT_MAX if the access left the line out)
+	template <int CACHE_WAYS>
+	void prefetch(bool is_instruction, unsigned int cache_index, uint64_t cache_tag, unsigned int line, bool miss, unsigned int physical_page_num)
+	{
+		Cache *cache = is_instruction ? instruction_cache : data_cache;
+		Prefetcher *prefetcher = is_instruction ? instruction_prefetcher : data_prefetcher;
+		PrefetchStatistics& counts = is_instruction ? stats.ic_prefetches : stats.dc_prefetches;
+		int index_bits = is_instruction ? config.instruction_cache_index_bits : config.data_cache_index_bits;
+		uint64_t line_address = (cache_tag << index_bits) | cache_index;
+		unsigned long long now = stats.inst_refs + stats.data_refs;
+		bool prefetched_hit = false;
+		bool late;
+		uint64_t candidates[MAX_PREFETCH_DEGREE];
+
+		if (miss) {
+			if (prefetcher->demandMiss(line_address)) {
+				++counts.polluting;
+			}
+			if (line != UINT_MAX) {
+				prefetcher->demandFill(line);
+			}
+		} else if (prefetcher->demandHit(line, now, late)) {
+			prefetched_hit = true;
+			++counts.useful;
+			if (late) {
+				++counts.late;
+			}
+		}
+		int n = prefetcher->train(line_address, miss, prefetched_hit, candidates);
+		for (int i = 0; i < n; ++i) {
+			unsigned int index = candidates[i] & ((1ull << index_bits) - 1);
+			uint64_t tag = candidates[i] >> index_bits;
+			if (cache->containsEntry<CACHE_WAYS>(index, tag)) {
+				continue;
+			}
+			// a clean fill like a read miss's, which nobody waits for
+			uint64_t replaced_key;
+			++counts.issued;
+			unsigned int filled = fetchLine<CACHE_WAYS>(is_instruction, index, tag, physical_page_num, false, false, replaced_key);
+			prefetcher->prefetchFill(filled, candidates[i], ((replaced_key & KEY_TAG) << index_bits) | index, (replaced_key & KEY_VALID) != 0, now);
+		}
+	}
+	// brings a line an L1 cache missed in from memory, or from the levels
+	// below, and fills it; returns the line it took and the key it replaced.
+	// A demand fill adds the cycles it waited below the L1 caches
+	template <int CACHE_WAYS>
+	unsigned int fetchLine(bool is_instruction, unsigned int cache_index, uint64_t cache_tag, unsigned int physical_page_num, bool is_write, bool demand, uint64_t& replaced_key)
+	{
+		Cache *cache = is_instruction ? instruction_cache : data_cache;
+		int index_bits = is_instruction ? config.instruction_cache_index_bits : config.data_cache_index_bits;
+		int offset_bits = is_instruction ? config.instruction_cache_offset_bits : config.data_cache_offset_bits;
+		bool replaced_dirty;
+		if (levels == nullptr) {
+			// only a write that replaced a dirty line writes it back
+			if (write_buffer == nullptr || !write_buffer->read(lineAddress(cache_tag, cache_index, index_bits, offset_bits))) {
+				++stats.memory_refs; // access next level of memory hierarchy
+				stats.miss_cycles += demand ? config.memory_latency : 0;
+			}
+			unsigned int line = cache->fillLine<CACHE_WAYS>(cache_index, cache_tag, physical_page_num, is_write ? 1 : 0, replaced_dirty, replaced_key);
+			if (replaced_dirty && is_write) { // if a write replaced a dirty cache entry, update next level of memory hierarchy
+				if (write_buffer != nullptr) {
+					write_buffer->write(lineAddress(replaced_key & KEY_TAG, cache_index, index_bits, offset_bits), 1);
+				} else {
+					++stats.memory_refs;
+				}
+			}
+			return line;
+		}
+		// every dirty victim goes down to the level below
+		bool dirty = false;
+		unsigned long long cycles = levels->read(0, lineAddress(cache_tag, cache_index, index_bits, offset_bits), dirty);
+		stats.miss_cycles += demand ? cycles : 0;
+		unsigned int line = cache->fillLine<CACHE_WAYS>(cache_index, cache_tag, physical_page_num, (is_write || dirty) ? 1 : 0, replaced_dirty, replaced_key);
+		if ((replaced_key & KEY_VALID) != 0) {
+			levels->evict(0, lineAddress(replaced_key & KEY_TAG, cache_index, index_bits, offset_bits), replaced_dirty);
+		}
+		return line;
+	}
+	void countWriteThrough(unsigned long long n, unsigned int cache_index, uint64_t cache_tag)
+	{
+		// n write-through stores to a data cache line pass every level down to memory
+		if (levels != nullptr) {
+			levels->writeThrough(n);
+		}
+		if (write_buffer != nullptr) {
+			write_buffer->write(lineAddress(cache_tag, cache_index, config.data_cache_index_bits, config.data_cache_offset_bits), n);
+		} else {
+			stats.memory_refs += n;
+		}
+	}
+	void forgetMemos()
+	{
+		memset(memos, 0, sizeof(memos));
+	}
+	void invalidateCaches(unsigned int physical_page_num)
+	{
+		// drop the lines of an evicted page from every cache and the write
+		// buffer; the dirty lines go straight to memory with the page
+		int invalidated_dirty_count = data_cache->invalidateEntries(physical_page_num);
+		if (levels != nullptr) {
+			invalidated_dirty_count += levels->invalidateEntries(physical_page_num);
+		}
+		if (!config.data_cache_write_through) { // need to write back invalidated data cache entries if write-back policy
+			stats.memory_refs += invalidated_dirty_count;
+			if (data_cache_sample != nullptr) {
+				data_cache_sample->addTraffic(invalidated_dirty_count);
+			}
+		}
+		instruction_cache->invalidateEntries(physical_page_num);
+		if (write_buffer != nullptr) {
+			write_buffer->drainPage(physical_page_num);
+		}
+	}
+	unsigned int handlePageFault(uint64_t virtual_page_num)
+	{
+		// go to disk and bring the page into the frame the policy frees
+		unsigned int physical_page_num;
+		bool referenced_before;
+		bool is_dirty;
+
+		++stats.pt_faults;
+		++stats.disk_refs;
+		physical_page_num = physical_pages->victimFrame();
+		referenced_before = physical_pages->wasReferencedBefore(physical_page_num);
+		is_dirty = physical_pages->wasModified(physical_page_num);
+		physical_pages->setModified(physical_page_num, false);
+		physical_pages->fill(physical_page_num);
+		if (referenced_before) {
+			// Page is being replaced, invalidate corresponding cache, TLB, and page table entries
+			PROFILE_START(profile, invalidation_timer);
+			if (is_dirty) { // if replaced page is dirty, need to write back to disk
+				++stats.disk_refs;
+			}
+			if (translated_trace != nullptr) {
+				translated_trace->writeEviction(physical_page_num, is_dirty);
+			}
+			forgetMemos();
+			page_table->invalidateEntries(physical_page_num);
+			if (shards != nullptr) {
+				shards->queueInvalidation(physical_page_num);
+			} else {
+				invalidateCaches(physical_page_num);
+			}
+			if (config.tlbs_enabled) {
+				data_tlb->invalidateEntries(physical_page_num);
+				instruction_tlb->invalidateEntries(physical_page_num);
+			}
+			PROFILE_STOP(profile, invalidation_timer, STAGE_INVALIDATION, 1);
+		}
+		page_table->addEntry(virtual_page_num, physical_page_num); // update page table
+		return physical_page_num;
+	}
+
+	ReplayKernel selectReplayKernel()
+	{
+		if (config.data_cache_write_through) {
+			return selectReplayWays<true>();
+		}
+		return selectReplayWays<false>();
+	}
+	template <bool WRITE_THROUGH>
+	ReplayKernel selectReplayWays()
+	{
+		if (config.instruction_cache_set_size == config.data_cache_set_size) {
+			switch (config.data_cache_set_size) {
+			case 1:
+				return &Hierarchy::replayKernel<WRITE_THROUGH, 1>;
+			case 2:
+				return &Hierarchy::replayKernel<WRITE_THROUGH, 2>;
+			case 4:
+				return &Hierarchy::replayKernel<WRITE_THROUGH, 4>;
+			case 8:
+				return &Hierarchy::replayKernel<WRITE_THROUGH, 8>;
+			}
+		}
+		return &Hierarchy::replayKernel<WRITE_THROUGH, 0>;
+	}
+
+	// kernel dispatch: the common associativities (direct-mapped, 2, 4 and 8
+	// way) are instantiated when both caches, respectively both TLBs, share it
+	Kernel selectKernel()
+	{
+		if (!config.virtual_addresses_enabled) {
+			return selectWritePolicy<false, false>();
+		} else if (!config.tlbs_enabled) {
+			return selectWritePolicy<true, false>();
+		}
+		return selectWritePolicy<true, true>();
+	}
+	template <bool VIRTUAL, bool TLBS>
+	Kernel selectWritePolicy()
+	{
+		if (config.data_cache_write_through) {
+			return selectCacheWays<VIRTUAL, TLBS, true>();
+		}
+		return selectCacheWays<VIRTUAL, TLBS, false>();
+	}
+	template <bool VIRTUAL, bool TLBS, bool WRITE_THROUGH>
+	Kernel selectCacheWays()
+	{
+		if (sample_rate > 1) {
+			return &Hierarchy::simulateKernel<VIRTUAL, TLBS, WRITE_THROUGH, 0, 0, KERNEL_SAMPLED>;
+		}
+		if (shards != nullptr) {
+			return selectTLBWays<VIRTUAL, TLBS, WRITE_THROUGH, 0, KERNEL_SHARDED>();
+		}
+		if (config.instruction_cache_set_size == config.data_cache_set_size) {
+			switch (config.data_cache_set_size) {
+			case 1:
+				return selectTLBWays<VIRTUAL, TLBS, WRITE_THROUGH, 1, KERNEL_EXACT>();
+			case 2:
+				return selectTLBWays<VIRTUAL, TLBS, WRITE_THROUGH, 2, KERNEL_EXACT>();
+			case 4:
+				return selectTLBWays<VIRTUAL, TLBS, WRITE_THROUGH, 4, KERNEL_EXACT>();
+			case 8:
+				return selectTLBWays<VIRTUAL, TLBS, WRITE_THROUGH, 8, KERNEL_EXACT>();
+			}
+		}
+		return selectTLBWays<VIRTUAL, TLBS, WRITE_THROUGH, 0, KERNEL_EXACT>();
+	}
+	template <bool VIRTUAL, bool TLBS, bool WRITE_THROUGH, int CACHE_WAYS, KernelMode MODE>
+	Kernel selectTLBWays()
+	{
+		if constexpr (TLBS) {
+			if (config.instruction_tlb_set_size == config.data_tlb_set_size) {
+				switch (config.data_tlb_set_size) {
+				case 1:
+					return &Hierarchy::simulateKernel<VIRTUAL, TLBS, WRITE_THROUGH, CACHE_WAYS, 1, MODE>;
+				case 2:
+					return &Hierarchy::simulateKernel<VIRTUAL, TLBS, WRITE_THROUGH, CACHE_WAYS, 2, MODE>;
+				case 4:
+					return &Hierarchy::simulateKernel<VIRTUAL, TLBS, WRITE_THROUGH, CACHE_WAYS, 4, MODE>;
+				case 8:
+					return &Hierarchy::simulateKernel<VIRTUAL, TLBS, WRITE_THROUGH, CACHE_WAYS, 8, MODE>;
+				}
+			}
+		}
+		return &Hierarchy::simulateKernel<VIRTUAL, TLBS, WRITE_THROUGH, CACHE_WAYS, 0, MODE>;
+	}
+
+	void estimateStatistics()
+	{
+		// scale the sampled hit and miss counters up to every reference; the
+		// translation ran in full, so page faults and disk references are exact
+		unsigned long long page_table_visits = 0;
+		estimate = stats;
+		estimate.ic_misses = instruction_cache_sample->estimateMisses(stats.inst_refs);
+		estimate.ic_hits = stats.inst_refs - estimate.ic_misses;
+		estimate.dc_misses = data_cache_sample->estimateMisses(stats.data_refs);
+		estimate.dc_hits = stats.data_refs - estimate.dc_misses;
+		if (config.tlbs_enabled) {
+			estimate.itlb_misses = instruction_tlb_sample->estimateMisses(stats.inst_refs);
+			estimate.itlb_hits = stats.inst_refs - estimate.itlb_misses;
+			estimate.dtlb_misses = data_tlb_sample->estimateMisses(stats.data_refs);
+			estimate.dtlb_hits = stats.data_refs - estimate.dtlb_misses;
+			page_table_visits = estimate.itlb_misses + estimate.dtlb_misses;
+			estimate.pt_hits = (page_table_visits > stats.pt_faults) ? page_table_visits - stats.pt_faults : 0;
+		} else if (config.virtual_addresses_enabled) {
+			page_table_visits = stats.inst_refs + stats.data_refs;
+		}
+		estimate.memory_refs = page_table_visits + instruction_cache_sample->estimateTraffic(stats.inst_refs) + data_cache_sample->estimateTraffic(stats.data_refs);
+	}
+	void printSampleInterval(const char *name, SetSample *sample)
+	{
+		double half_width = sample->confidenceHalfWidth();
+		printf("%-17s: %f +/- ", name, 1.0 - sample->missRatio());
+		if (half_width < 0) {
+			printf("unknown");
+		} else {
+			printf("%f", half_width);
+		}
+		printf(" (%d of %d sets)\n", sample->sampledSets(), sample->sets());
+	}
+
+	const Config config; // a copy, the caller's Config need not outlive this
+	Cache *instruction_cache = nullptr;
+	Cache *data_cache = nullptr;
+	CacheShards *shards = nullptr;
+	PageTable *page_table;
+	TLB *instruction_tlb;
+	TLB *data_tlb;
+	FrameManager *physical_pages;
+	Statistics stats;
+	Statistics estimate;
+	StreamMemo memos[2]; // data, instruction
+	bool memo_tlb_fills[2]; // a TLB fill may be memoized, see simulateReference
+	bool memo_cache_hits[2];
+	bool memo_cache_fills[2];
+	Prefetcher *instruction_prefetcher = nullptr;
+	Prefetcher *data_prefetcher = nullptr;
+	CacheLevels *levels = nullptr;
+	WriteBuffer *write_buffer = nullptr;
+	unsigned long long restored_references = 0;
+#ifdef HIERARCHY_PROFILE
+	Profiler profile;
+#endif
+	int sample_rate;
+	SetSample *instruction_cache_sample = nullptr;
+	SetSample *data_cache_sample = nullptr;
+	SetSample *instruction_tlb_sample = nullptr;
+	SetSample *data_tlb_sample = nullptr;
+	Kernel kernel;
+	ReplayKernel replay_kernel;
+	TranslatedTraceWriter *translated_trace = nullptr;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef INTERVALS_H
+#define INTERVALS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "error.h"
+#include "statistics.h"
+
+using namespace std;
+
+// the columns of an interval snapshot: the references simulated so far
+// and the running totals of the translation, cache and memory counters
+const int INTERVAL_COLUMNS = 13;
+
+const char *const INTERVAL_COLUMN_NAMES[INTERVAL_COLUMNS] = {
+	"references", "itlb_hits", "itlb_misses", "dtlb_hits", "dtlb_misses", "pt_hits", "pt_faults",
+	"ic_hits", "ic_misses", "dc_hits", "dc_misses", "memory_refs", "disk_refs"
+};
+
+struct IntervalFileHeader
+{
+	char magic[4]; // "HINT"
+	uint32_t version;
+	uint32_t columns; // INTERVAL_COLUMNS
+	uint32_t reserved;
+	uint64_t interval; // trace records between snapshots
+};
+
+const uint32_t INTERVAL_FILE_VERSION = 1;
+
+// Writes a snapshot of the statistics every interval trace records, as a
+// CSV table or as a binary file of rows of INTERVAL_COLUMNS uint64_t after
+// an IntervalFileHeader; the caller splits its batches at the interval
+// boundaries, so the simulation loop itself never checks for one.
+class IntervalWriter
+{
+public:
+	IntervalWriter(string filename, bool binary, unsigned long long n)
+	{
+		interval = n;
+		is_binary = binary;
+		out = fopen(filename.c_str(), binary ? "wb" : "w");
+		if (out == nullptr) {
+			throwError("failed to open %s for writing", filename.c_str());
+		}
+		if (is_binary) {
+			IntervalFileHeader header;
+			memset(&header, 0, sizeof(header));
+			memcpy(header.magic, "HINT", 4);
+			header.version = INTERVAL_FILE_VERSION;
+			header.columns = INTERVAL_COLUMNS;
+			header.interval = interval;
+			if (fwrite(&header, sizeof(header), 1, out) < 1) {
+				fclose(out);
+				throwError("failed to write the interval statistics");
+			}
+		} else {
+			for (int i = 0; i < INTERVAL_COLUMNS; ++i) {
+				fprintf(out, (i == 0) ? "%s" : ",%s", INTERVAL_COLUMN_NAMES[i]);
+			}
+			fprintf(out, "\n");
+		}
+	}
+	~IntervalWriter()
+	{
+		if (out != nullptr) {
+			fclose(out); // not closed, so a failure here goes unreported
+		}
+	}
+	void close()
+	{
+		// a destructor cannot report a failed write, so the owner closes;
+		// ferror also catches the CSV rows fprintf failed to write
+		bool failed = ferror(out) != 0;
+		failed = (fclose(out) != 0) || failed;
+		out = nullptr;
+		if (failed) {
+			throwError("failed to write the interval statistics");
+		}
+	}
+	unsigned long long length()
+	{
+		return interval;
+	}
+	void writeSnapshot(const Statistics& stats)
+	{
+		uint64_t row[INTERVAL_COLUMNS] = {
+			stats.inst_refs + stats.data_refs,
+			stats.itlb_hits,
+			stats.itlb_misses,
+			stats.dtlb_hits,
+			stats.dtlb_misses,
+			stats.pt_hits,
+			stats.pt_faults,
+			stats.ic_hits,
+			stats.ic_misses,
+			stats.dc_hits,
+			stats.dc_misses,
+			stats.memory_refs,
+			stats.disk_refs,
+		};
+		if (is_binary) {
+			if (fwrite(row, sizeof(row), 1, out) < 1) {
+				throwError("failed to write the interval statistics");
+			}
+			return;
+		}
+		for (int i = 0; i < INTERVAL_COLUMNS; ++i) {
+			fprintf(out, (i == 0) ? "%llu" : ",%llu", static_cast<unsigned long long>(row[i]));
+		}
+		fprintf(out, "\n");
+	}
+private:
+	FILE *out;
+	bool is_binary;
+	unsigned long long interval;
+};
+
+#endif
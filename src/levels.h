@@ -0,0 +1,183 @@
+#ifndef LEVELS_H
+#define LEVELS_H
+
+#include <climits>
+#include <cstdint>
+#include "cache.h"
+#include "checkpoint.h"
+#include "config.h"
+#include "statistics.h"
+#include "writebuffer.h"
+
+using namespace std;
+
+inline uint64_t lineAddress(uint64_t tag, unsigned int index, int index_bits, int offset_bits)
+{
+	// the physical address of a line from its tag and set
+	return ((tag << index_bits) | index) << offset_bits;
+}
+
+// The unified cache levels below the split L1 caches, level 2 first, with
+// main memory behind the last. Hierarchy reads the lines its L1 caches miss
+// through read and hands their victims to evict; the levels count their
+// own LevelStatistics and the main memory references, which go through the
+// write buffer when there is one. Every level follows
+// the write policy of the data cache: write-back levels allocate the dirty
+// victims they are handed, write-through ones see only clean lines while
+// the stores themselves pass every level (see writeThrough).
+class CacheLevels
+{
+public:
+	CacheLevels(const Config& c, Cache *ic, Cache *dc, Statistics *s, WriteBuffer *wb) : config(c)
+	{
+		instruction_cache = ic;
+		data_cache = dc;
+		stats = s;
+		write_buffer = wb;
+		for (int k = 0; k < config.lower_levels; ++k) {
+			caches[k] = new Cache(config.levels[k].sets, config.levels[k].set_size, config.physical_pages, "unified", POLICY_LRU, ReplacementContext(config.replacement_seed, STRUCTURE_DATA_CACHE));
+		}
+	}
+	~CacheLevels()
+	{
+		for (int k = 0; k < config.lower_levels; ++k) {
+			delete caches[k];
+		}
+	}
+	// the line at address, which the level above level missed; returns the
+	// cycles it took from level on, and sets dirty when an exclusive level
+	// handed up its dirty copy
+	unsigned long long read(int level, uint64_t address, bool& dirty)
+	{
+		if (level == config.lower_levels) {
+			if (write_buffer != nullptr && write_buffer->read(address)) {
+				return 0;
+			}
+			++stats->memory_refs;
+			return config.memory_latency;
+		}
+		const LevelConfig& l = config.levels[level];
+		LevelStatistics& counts = stats->levels[level];
+		unsigned int line = caches[level]->findLine(l.index.extract(address), l.tag.extract(address));
+		if (line != UINT_MAX) {
+			++counts.hits;
+			if (l.inclusion == INCLUSION_EXCLUSIVE) {
+				dirty = caches[level]->invalidateLine(line) != 0; // moves up
+			}
+			return l.hit_latency;
+		}
+		++counts.misses;
+		++counts.traffic;
+		unsigned long long cycles = l.hit_latency + read(level + 1, address, dirty);
+		if (l.inclusion != INCLUSION_EXCLUSIVE) {
+			fill(level, address, dirty);
+			dirty = false;
+		}
+		return cycles;
+	}
+	// the line at address, which the level above level evicted: a dirty
+	// line is written back, and an exclusive level keeps even a clean one
+	void evict(int level, uint64_t address, bool dirty)
+	{
+		bool exclusive = (level < config.lower_levels && config.levels[level].inclusion == INCLUSION_EXCLUSIVE);
+		if (!dirty && !exclusive) {
+			return;
+		}
+		if (level > 0) {
+			++stats->levels[level - 1].traffic;
+		}
+		if (level == config.lower_levels) {
+			if (write_buffer != nullptr) {
+				write_buffer->write(address, 1);
+			} else {
+				++stats->memory_refs;
+			}
+			return;
+		}
+		const LevelConfig& l = config.levels[level];
+		++stats->levels[level].writes;
+		unsigned int line = caches[level]->findLine(l.index.extract(address), l.tag.extract(address));
+		if (line == UINT_MAX) {
+			fill(level, address, dirty);
+		} else if (dirty) {
+			caches[level]->setDirty(line);
+		}
+	}
+	// n write-through stores, which pass every level on to memory without
+	// allocating or changing the recency of the copies they update
+	void writeThrough(unsigned long long n)
+	{
+		for (int k = 0; k < config.lower_levels; ++k) {
+			stats->levels[k].writes += n;
+			stats->levels[k].traffic += n;
+		}
+	}
+	int invalidateEntries(unsigned int phys_page_num)
+	{
+		// the dirty lines of an evicted page in every level
+		int dirty_count = 0;
+		for (int k = 0; k < config.lower_levels; ++k) {
+			dirty_count += caches[k]->invalidateEntries(phys_page_num);
+		}
+		return dirty_count;
+	}
+	void save(CheckpointWriter& out)
+	{
+		for (int k = 0; k < config.lower_levels; ++k) {
+			caches[k]->save(out);
+		}
+	}
+	void restore(CheckpointReader& in)
+	{
+		for (int k = 0; k < config.lower_levels; ++k) {
+			caches[k]->restore(in);
+		}
+	}
+private:
+	void fill(int level, uint64_t address, bool dirty)
+	{
+		const LevelConfig& l = config.levels[level];
+		unsigned int index = l.index.extract(address);
+		bool replaced_dirty;
+		uint64_t replaced_key;
+		caches[level]->fillLine(index, l.tag.extract(address), address >> config.page_offset_bits, dirty ? 1 : 0, replaced_dirty, replaced_key);
+		if ((replaced_key & KEY_VALID) == 0) {
+			return;
+		}
+		uint64_t victim = lineAddress(replaced_key & KEY_TAG, index, l.index_bits, l.offset_bits);
+		if (l.inclusion == INCLUSION_INCLUSIVE && invalidateAbove(level, victim, l.line_size)) {
+			replaced_dirty = true; // the newer data of a copy above goes down
+		}
+		evict(level + 1, victim, replaced_dirty);
+	}
+	bool invalidateAbove(int level, uint64_t address, int line_size)
+	{
+		// drops the line from every cache above level; true if a copy was dirty
+		bool dirty = false;
+		for (int k = 0; k < level; ++k) {
+			for (int offset = 0; offset < line_size; offset += config.levels[k].line_size) {
+				dirty = invalidate(caches[k], config.levels[k].index, config.levels[k].tag, address + offset) || dirty;
+			}
+		}
+		for (int offset = 0; offset < line_size; offset += config.instruction_cache_line_size) {
+			invalidate(instruction_cache, config.instruction_cache_index, config.instruction_cache_tag, address + offset);
+		}
+		for (int offset = 0; offset < line_size; offset += config.data_cache_line_size) {
+			dirty = invalidate(data_cache, config.data_cache_index, config.data_cache_tag, address + offset) || dirty;
+		}
+		return dirty;
+	}
+	bool invalidate(Cache *cache, const AddressField& index, const AddressField& tag, uint64_t address)
+	{
+		return cache->invalidateEntry(index.extract(address), tag.extract(address)) > 0;
+	}
+
+	const Config& config;
+	Cache *instruction_cache;
+	Cache *data_cache;
+	Cache *caches[MAX_LOWER_LEVELS];
+	Statistics *stats;
+	WriteBuffer *write_buffer;
+};
+
+#endif
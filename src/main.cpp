@@ -0,0 +1,410 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "analysis.h"
+#include "config.h"
+#include "error.h"
+#include "hierarchy.h"
+#include "intervals.h"
+#include "profile.h"
+#include "report.h"
+#include "statistics.h"
+#include "sweep.h"
+#include "trace.h"
+#include "translated.h"
+using namespace std;
+
+void simulateBatch(Hierarchy*, const TraceRecord*, size_t, ReportWriter*, IntervalWriter*, unsigned long long&);
+void printUsage();
+int run(int, char**);
+
+int main(int argc, char **argv)
+{
+	// the library throws where the command line tool gives up
+	try {
+		return run(argc, argv);
+	} catch (const HierarchyError& e) {
+		fprintf(stderr, "hierarchy: %s\n", e.what());
+		exit(EXIT_FAILURE);
+	}
+}
+
+int run(int argc, char **argv)
+{
+	int opt;
+	string text_trace_filename;
+	string binary_trace_filename;
+	string convert_filename;
+	unsigned long long coalesce_line_size = 0;
+	string output_mode;
+	string report_filename;
+	string sweep_filename;
+	int threads = 1;
+	bool miss_ratio_analysis = false;
+	int sample_rate = 1;
+	string checkpoint_filename;
+	unsigned long long checkpoint_references = 0;
+	string restore_filename;
+	int decoder_threads = 0;
+	string translated_filename;
+	string replay_filename;
+	string interval_filename;
+	bool binary_intervals = false;
+	unsigned long long interval_length = 0;
+	unsigned long long references = 0;
+	ReportWriter *report = nullptr;
+	IntervalWriter *intervals = nullptr;
+	int trace_fd;
+	TraceReader *trace = nullptr;
+	TranslatedTraceReader *replay_trace = nullptr;
+	TranslatedTraceWriter *translated_trace = nullptr;
+	const TranslatedRecord *translated_batch;
+	const TraceRecord *batch;
+	size_t count;
+	Hierarchy *hierarchy;
+
+	while ((opt = getopt(argc, argv, "t:b:c:k:o:r:s:j:mp:w:n:l:d:T:x:i:I:e:")) != -1) {
+		switch (opt) {
+		case 't':
+			text_trace_filename = optarg;
+			break;
+		case 'b':
+			binary_trace_filename = optarg;
+			break;
+		case 'c':
+			convert_filename = optarg;
+			break;
+		case 'k':
+			coalesce_line_size = strtoull(optarg, nullptr, 10);
+			if (!isPowerOfTwo(coalesce_line_size)) {
+				fprintf(stderr, "hierarchy: the coalescing line size must be a power of two\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'o':
+			output_mode = optarg;
+			break;
+		case 'r':
+			report_filename = optarg;
+			break;
+		case 's':
+			sweep_filename = optarg;
+			break;
+		case 'j':
+			threads = atoi(optarg);
+			if (threads < 1) {
+				fprintf(stderr, "hierarchy: the number of threads must be at least 1\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'm':
+			miss_ratio_analysis = true;
+			break;
+		case 'p':
+			sample_rate = atoi(optarg);
+			if (sample_rate < 1 || !isPowerOfTwo(sample_rate)) {
+				fprintf(stderr, "hierarchy: the set sampling rate must be a power of two\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'w':
+			checkpoint_filename = optarg;
+			break;
+		case 'n':
+			checkpoint_references = strtoull(optarg, nullptr, 10);
+			break;
+		case 'l':
+			restore_filename = optarg;
+			break;
+		case 'd':
+			decoder_threads = atoi(optarg);
+			if (decoder_threads < 1) {
+				fprintf(stderr, "hierarchy: the number of decoder threads must be at least 1\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'T':
+			translated_filename = optarg;
+			break;
+		case 'x':
+			replay_filename = optarg;
+			break;
+		case 'i':
+		case 'I':
+			interval_filename = optarg;
+			binary_intervals = (opt == 'I');
+			break;
+		case 'e':
+			interval_length = strtoull(optarg, nullptr, 10);
+			break;
+		default:
+			printUsage();
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind < argc || (!text_trace_filename.empty() && !binary_trace_filename.empty())) {
+		printUsage();
+		exit(EXIT_FAILURE);
+	}
+	if (coalesce_line_size != 0 && convert_filename.empty()) {
+		fprintf(stderr, "hierarchy: -k only applies to the conversion of a trace with -c\n");
+		exit(EXIT_FAILURE);
+	}
+	if (!sweep_filename.empty() && !output_mode.empty() && output_mode != "stats") {
+		fprintf(stderr, "hierarchy: a sweep only prints statistics, -o cannot be used with -s\n");
+		exit(EXIT_FAILURE);
+	}
+	if (miss_ratio_analysis && (!sweep_filename.empty() || !output_mode.empty() || sample_rate > 1)) {
+		fprintf(stderr, "hierarchy: -m prints only the miss ratio tables, it cannot be used with -s, -o or -p\n");
+		exit(EXIT_FAILURE);
+	}
+	if (sample_rate > 1 && !output_mode.empty() && output_mode != "stats") {
+		fprintf(stderr, "hierarchy: a sampled run only prints statistics, -o cannot be used with -p\n");
+		exit(EXIT_FAILURE);
+	}
+	if (checkpoint_filename.empty() != (checkpoint_references == 0)) {
+		fprintf(stderr, "hierarchy: -w and a positive -n are required together\n");
+		exit(EXIT_FAILURE);
+	}
+	if ((!checkpoint_filename.empty() || !restore_filename.empty()) && (!sweep_filename.empty() || miss_ratio_analysis || sample_rate > 1 || threads > 1)) {
+		fprintf(stderr, "hierarchy: checkpoints cannot be used with -s, -m, -p or -j\n");
+		exit(EXIT_FAILURE);
+	}
+	if (!replay_filename.empty() && (!text_trace_filename.empty() || !binary_trace_filename.empty() || !convert_filename.empty() || decoder_threads > 0 || miss_ratio_analysis || sample_rate > 1 || !checkpoint_filename.empty() || !restore_filename.empty() || !translated_filename.empty())) {
+		fprintf(stderr, "hierarchy: -x takes the place of the trace, it cannot be used with -t, -b, -c, -d, -m, -p, -w, -l or -T\n");
+		exit(EXIT_FAILURE);
+	}
+	if (!replay_filename.empty() && !output_mode.empty() && output_mode != "stats") {
+		fprintf(stderr, "hierarchy: a replay only prints statistics, -o cannot be used with -x\n");
+		exit(EXIT_FAILURE);
+	}
+	if (!translated_filename.empty() && (!sweep_filename.empty() || miss_ratio_analysis || sample_rate > 1 || !convert_filename.empty() || !checkpoint_filename.empty() || !restore_filename.empty())) {
+		fprintf(stderr, "hierarchy: -T records a full run of one configuration, it cannot be used with -s, -m, -p, -c, -w or -l\n");
+		exit(EXIT_FAILURE);
+	}
+	if (threads > 1 && sweep_filename.empty() && (miss_ratio_analysis || sample_rate > 1 || !replay_filename.empty())) {
+		fprintf(stderr, "hierarchy: -j only applies to sweeps and to full simulations of one configuration\n");
+		exit(EXIT_FAILURE);
+	}
+	if (interval_filename.empty() != (interval_length == 0)) {
+		fprintf(stderr, "hierarchy: -i or -I and a positive -e are required together\n");
+		exit(EXIT_FAILURE);
+	}
+	if (!interval_filename.empty() && (!sweep_filename.empty() || miss_ratio_analysis || !convert_filename.empty() || !replay_filename.empty())) {
+		fprintf(stderr, "hierarchy: interval statistics follow one simulated trace, they cannot be used with -s, -m, -c or -x\n");
+		exit(EXIT_FAILURE);
+	}
+	if (decoder_threads > 0 && !binary_trace_filename.empty()) {
+		fprintf(stderr, "hierarchy: -d only applies to text traces\n");
+		exit(EXIT_FAILURE);
+	}
+	if ((sample_rate > 1 || !replay_filename.empty()) && output_mode.empty()) {
+		output_mode = "stats";
+	}
+	if (output_mode.empty()) {
+		output_mode = "text";
+	}
+	if (output_mode != "text" && output_mode != "binary" && output_mode != "stats") {
+		fprintf(stderr, "hierarchy: unknown output mode %s\n", output_mode.c_str());
+		exit(EXIT_FAILURE);
+	}
+	if ((output_mode == "binary") != !report_filename.empty()) {
+		fprintf(stderr, "hierarchy: -r is required by, and only valid with, the binary output mode\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!replay_filename.empty()) {
+		replay_trace = new TranslatedTraceReader(replay_filename);
+	} else if (!binary_trace_filename.empty()) {
+		trace = new BinaryTraceReader(binary_trace_filename);
+	} else {
+		trace_fd = STDIN_FILENO;
+		if (!text_trace_filename.empty()) {
+			trace_fd = open(text_trace_filename.c_str(), O_RDONLY);
+			if (trace_fd < 0) {
+				fprintf(stderr, "hierarchy: failed to open trace %s\n", text_trace_filename.c_str());
+				exit(EXIT_FAILURE);
+			}
+		}
+		if (decoder_threads > 0) {
+			trace = new PipelinedTraceReader(trace_fd, decoder_threads);
+		} else {
+			trace = new TextTraceReader(trace_fd);
+		}
+	}
+
+	if (!convert_filename.empty()) {
+		// only translate the trace to the binary format, no simulation
+		writeBinaryTrace(trace, convert_filename, coalesce_line_size);
+		delete trace;
+		return 0;
+	}
+
+	if (!sweep_filename.empty()) {
+		runSweep(trace, replay_trace, sweep_filename, threads, sample_rate);
+		delete trace;
+		delete replay_trace;
+		return 0;
+	}
+
+	if (miss_ratio_analysis) {
+		runMissRatioAnalysis(trace);
+		delete trace;
+		return 0;
+	}
+
+	const Config config = getConfig("trace.config");
+	printConfig(config);
+
+	printf("\n");
+
+	hierarchy = new Hierarchy(config, sample_rate, threads);
+
+	if (output_mode == "text") {
+		report = new TextReportWriter(config);
+	} else if (output_mode == "binary") {
+		report = new BinaryReportWriter(config, report_filename);
+	}
+	if (report != nullptr) {
+		report->writeHeader();
+	}
+	if (!translated_filename.empty()) {
+		translated_trace = new TranslatedTraceWriter(config, translated_filename);
+		hierarchy->recordTranslation(translated_trace);
+	}
+	if (!interval_filename.empty()) {
+		intervals = new IntervalWriter(interval_filename, binary_intervals, interval_length);
+	}
+
+	if (replay_trace != nullptr) {
+		replay_trace->checkConfig(config);
+		for (;;) {
+			PROFILE_START(hierarchy->profiler(), parse_timer);
+			count = replay_trace->nextBatch(translated_batch);
+			PROFILE_STOP(hierarchy->profiler(), parse_timer, STAGE_PARSE, count);
+			if (count == 0) {
+				break;
+			}
+			hierarchy->replay(translated_batch, count);
+		}
+	}
+	if (!restore_filename.empty()) {
+		// resume after the references the checkpoint already simulated
+		references = hierarchy->restoreCheckpoint(restore_filename);
+		if (checkpoint_references != 0 && checkpoint_references <= references) {
+			fprintf(stderr, "hierarchy: checkpoint %s is already past reference %llu\n", restore_filename.c_str(), checkpoint_references);
+			exit(EXIT_FAILURE);
+		}
+		if (trace->skip(references) < references) {
+			fprintf(stderr, "hierarchy: the trace is shorter than checkpoint %s\n", restore_filename.c_str());
+			exit(EXIT_FAILURE);
+		}
+	}
+	while (trace != nullptr) {
+		PROFILE_START(hierarchy->profiler(), parse_timer);
+		count = trace->nextBatch(batch);
+		PROFILE_STOP(hierarchy->profiler(), parse_timer, STAGE_PARSE, count);
+		if (count == 0) {
+			break;
+		}
+		if (checkpoint_references != 0 && references + count >= checkpoint_references) {
+			// simulate up to the checkpoint, save the warm state and stop
+			simulateBatch(hierarchy, batch, checkpoint_references - references, report, intervals, references);
+			hierarchy->saveCheckpoint(checkpoint_filename, references);
+			break;
+		}
+		simulateBatch(hierarchy, batch, count, report, intervals, references);
+	}
+	if (checkpoint_references != 0 && references < checkpoint_references) {
+		fprintf(stderr, "hierarchy: the trace ends after %llu references, before the checkpoint\n", references);
+		exit(EXIT_FAILURE);
+	}
+
+	if (report != nullptr) {
+		report->close(); // flushes the table ahead of the statistics
+	}
+	delete report;
+	if (translated_trace != nullptr) {
+		translated_trace->close();
+	}
+	delete translated_trace;
+	if (intervals != nullptr) {
+		if (references % intervals->length() != 0) {
+			intervals->writeSnapshot(hierarchy->statistics()); // the last, shorter interval
+		}
+		intervals->close();
+	}
+	delete intervals;
+
+	printStatistics(config, hierarchy->statistics());
+	hierarchy->printSampling();
+	hierarchy->printProfile();
+
+	delete hierarchy;
+	delete trace;
+	delete replay_trace;
+
+	return 0;
+}
+
+void simulateBatch(Hierarchy *hierarchy, const TraceRecord *batch, size_t count, ReportWriter *report, IntervalWriter *intervals, unsigned long long& references)
+{
+	// simulates count records, stopping for a snapshot at every multiple of
+	// the interval length they cross; references counts the records so far
+	while (intervals != nullptr) {
+		unsigned long long next = (references / intervals->length() + 1) * intervals->length();
+		if (references + count < next) {
+			break;
+		}
+		size_t n = next - references;
+		hierarchy->simulate(batch, n, report);
+		batch += n;
+		count -= n;
+		references += n;
+		intervals->writeSnapshot(hierarchy->statistics());
+	}
+	hierarchy->simulate(batch, count, report);
+	references += count;
+}
+
+void printUsage()
+{
+	fprintf(stderr, "usage: hierarchy [-t trace_file | -b binary_trace_file] [-c binary_output_file [-k line_size]] [-o text | stats | binary -r report_file] [-s sweep_file | -m] [-j threads] [-p rate]\n");
+	fprintf(stderr, "                 [-w checkpoint_file -n references] [-l checkpoint_file] [-d decoders] [-T translated_file | -x translated_file]\n");
+	fprintf(stderr, "                 [-i csv_file | -I binary_file -e references]\n");
+	fprintf(stderr, "  -t  read the text trace from trace_file instead of standard input\n");
+	fprintf(stderr, "  -b  read a binary trace (see -c) through mmap\n");
+	fprintf(stderr, "  -d  parse the text trace on a reader thread and this many decoder threads,\n");
+	fprintf(stderr, "      overlapping it with the simulation\n");
+	fprintf(stderr, "  -c  convert the trace to the binary format, write it to binary_output_file and exit\n");
+	fprintf(stderr, "  -k  with -c, fold each run of consecutive references of one stream and access type\n");
+	fprintf(stderr, "      to the same line_size-byte line into one counted record; the statistics stay\n");
+	fprintf(stderr, "      exact while line_size is at most the line and page sizes simulated, the table\n");
+	fprintf(stderr, "      repeats the first address of each run, and -n counts records\n");
+	fprintf(stderr, "  -o  per-reference output: a text table (default), nothing but the statistics,\n");
+	fprintf(stderr, "      or binary records written to report_file\n");
+	fprintf(stderr, "  -s  simulate every configuration listed in sweep_file in one pass over the trace\n");
+	fprintf(stderr, "      and print one statistics block per configuration; each line of sweep_file is\n");
+	fprintf(stderr, "      a configuration file followed by optional overrides such as dc_sets=64..1024\n");
+	fprintf(stderr, "      (powers of two), dc_assoc=1,2,4 or ic_line=32 (see SWEEP_PARAMETERS)\n");
+	fprintf(stderr, "  -j  simulate the sweep configurations on this many threads (default 1); without -s,\n");
+	fprintf(stderr, "      translate serially and split the cache sets over this many threads\n");
+	fprintf(stderr, "  -m  instead of simulating trace.config, print the LRU miss ratios of every cache\n");
+	fprintf(stderr, "      and TLB geometry with its line and page sizes, found in one pass\n");
+	fprintf(stderr, "  -p  simulate only one in every rate sets (a power of two) of the caches and TLBs\n");
+	fprintf(stderr, "      and estimate their counters, with confidence intervals; implies -o stats\n");
+	fprintf(stderr, "  -w  after the first -n references of the trace, save the complete simulator state\n");
+	fprintf(stderr, "      to checkpoint_file and stop\n");
+	fprintf(stderr, "  -l  restore the state saved by -w (with the same configuration) and resume the\n");
+	fprintf(stderr, "      simulation after the references it had covered\n");
+	fprintf(stderr, "  -T  also write the translated trace (physical addresses, TLB and page table\n");
+	fprintf(stderr, "      results and page evictions) to translated_file\n");
+	fprintf(stderr, "  -x  read no trace but replay translated_file through the caches alone; the TLB and\n");
+	fprintf(stderr, "      page configuration must be the one it was recorded with; implies -o stats\n");
+	fprintf(stderr, "  -i  every -e references, and once more at the end of the trace, append the running\n");
+	fprintf(stderr, "      totals of the TLB, page table, cache, memory and disk counters to csv_file\n");
+	fprintf(stderr, "  -I  the same snapshots as binary rows of 64-bit counters (see intervals.h)\n");
+	fprintf(stderr, "  -e  the references between snapshots; like -n it counts records of a coalesced trace\n");
+}
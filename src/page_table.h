@@ -0,0 +1,196 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include <climits>
+#include <cstdint>
+#include "checkpoint.h"
+
+using namespace std;
+
+class PageTableEntry
+{
+public:
+	PageTableEntry()
+	{
+		phys_page_num = UINT_MAX;
+		resident_bit = 0;
+		dirty_bit = 0;
+	}
+  	void setPhysPageNum(unsigned int p)
+  	{
+  		phys_page_num = p;
+  	}
+  	void setResidentBit(unsigned int r)
+  	{
+  		resident_bit = r;
+  	}
+	void setDirtyBit(unsigned int d)
+  	{
+  		dirty_bit = d;
+  	}
+  	unsigned int getPhysPageNum()
+  	{
+  		return phys_page_num;
+  	}
+  	unsigned int getResidentBit()
+  	{
+  		return resident_bit;
+  	}
+  	unsigned int getDirtyBit()
+  	{
+  		return dirty_bit;
+  	}
+private:
+	unsigned int phys_page_num;
+	unsigned int resident_bit;
+	unsigned int dirty_bit;
+};
+
+class PageTable
+{
+public:
+	// radix tree over the virtual page number, LEVEL_BITS bits per level with
+	// the remainder at the root; nodes and leaves of entries are allocated by
+	// the first page fault below them, so memory grows with the touched pages
+	PageTable(int index_bits, int f)
+	{
+		num_levels = max(1, (index_bits + LEVEL_BITS - 1) / LEVEL_BITS);
+		root_bits = index_bits - (num_levels - 1) * LEVEL_BITS;
+		num_frames = f;
+		root = nullptr;
+		// reverse map from frame to the virtual page resident in it
+		frame_owners = new uint64_t[num_frames];
+		for (unsigned int i = 0; i < num_frames; ++i) {
+			frame_owners[i] = NO_OWNER;
+		}
+	}
+	~PageTable()
+	{
+		deleteNode(root, 0);
+		delete[] frame_owners;
+	}
+	unsigned int readEntry(uint64_t index)
+	{
+		PageTableEntry *e = findEntry(index, false);
+		if (e != nullptr && e->getResidentBit() == 1) {
+			return e->getPhysPageNum();
+		}
+		return UINT_MAX;
+	}
+	void addEntry(uint64_t index, unsigned int phys_page_num)
+	{
+		PageTableEntry *e = findEntry(index, true);
+		e->setPhysPageNum(phys_page_num);
+		e->setResidentBit(1);
+		if (phys_page_num < num_frames) {
+			frame_owners[phys_page_num] = index;
+		}
+	}
+	void invalidateEntries(unsigned int phys_page_num)
+	{
+		// a frame holds at most one resident page; entries that were resident in
+		// it earlier have already been invalidated when it was last replaced
+		uint64_t owner = ownerOf(phys_page_num);
+		if (owner != NO_OWNER) {
+			PageTableEntry *e = findEntry(owner, false);
+			e->setResidentBit(0);
+			e->setDirtyBit(0);
+			frame_owners[phys_page_num] = NO_OWNER;
+		}
+	}
+	void setPageDirtyBit(unsigned int phys_page_num)
+	{
+		uint64_t owner = ownerOf(phys_page_num);
+		if (owner != NO_OWNER) {
+			findEntry(owner, false)->setDirtyBit(1);
+		}
+	}
+	void save(CheckpointWriter& out)
+	{
+		// only resident entries matter, and each is the owner of its frame, so
+		// the table is saved as the frame owners and their dirty bits
+		unsigned char *dirty_bits = new unsigned char[num_frames]();
+		for (unsigned int i = 0; i < num_frames; ++i) {
+			if (frame_owners[i] != NO_OWNER) {
+				dirty_bits[i] = findEntry(frame_owners[i], false)->getDirtyBit();
+			}
+		}
+		out.write(frame_owners, num_frames * sizeof(uint64_t));
+		out.write(dirty_bits, num_frames);
+		delete[] dirty_bits;
+	}
+	void restore(CheckpointReader& in)
+	{
+		uint64_t *owners = new uint64_t[num_frames];
+		unsigned char *dirty_bits = new unsigned char[num_frames];
+		in.read(owners, num_frames * sizeof(uint64_t));
+		in.read(dirty_bits, num_frames);
+		for (unsigned int i = 0; i < num_frames; ++i) {
+			if (owners[i] != NO_OWNER) {
+				addEntry(owners[i], i);
+				findEntry(owners[i], false)->setDirtyBit(dirty_bits[i]);
+			}
+		}
+		delete[] owners;
+		delete[] dirty_bits;
+	}
+private:
+	static const int LEVEL_BITS = 6;
+	static const uint64_t NO_OWNER = UINT64_MAX;
+
+	uint64_t ownerOf(unsigned int phys_page_num)
+	{
+		return (phys_page_num < num_frames) ? frame_owners[phys_page_num] : NO_OWNER;
+	}
+	int levelBits(int level)
+	{
+		return (level == 0) ? root_bits : LEVEL_BITS;
+	}
+	PageTableEntry *findEntry(uint64_t index, bool allocate)
+	{
+		// interior nodes are arrays of child pointers, the last level is an
+		// array of entries
+		void **node = &root;
+		for (int level = 0; level < num_levels; ++level) {
+			if (*node == nullptr) {
+				if (!allocate) {
+					return nullptr;
+				}
+				if (level == num_levels - 1) {
+					*node = new PageTableEntry[1 << levelBits(level)];
+				} else {
+					*node = new void*[1 << levelBits(level)]();
+				}
+			}
+			uint64_t slot = (index >> ((num_levels - 1 - level) * LEVEL_BITS)) & ((1 << levelBits(level)) - 1);
+			if (level == num_levels - 1) {
+				return static_cast<PageTableEntry*>(*node) + slot;
+			}
+			node = static_cast<void**>(*node) + slot;
+		}
+		return nullptr;
+	}
+	void deleteNode(void *node, int level)
+	{
+		if (node == nullptr) {
+			return;
+		}
+		if (level == num_levels - 1) {
+			delete[] static_cast<PageTableEntry*>(node);
+			return;
+		}
+		void **children = static_cast<void**>(node);
+		for (int i = 0; i < (1 << levelBits(level)); ++i) {
+			deleteNode(children[i], level + 1);
+		}
+		delete[] children;
+	}
+
+	int num_levels;
+	int root_bits;
+	unsigned int num_frames;
+	void *root;
+	uint64_t *frame_owners;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <climits>
+#include <cstdint>
+#include "checkpoint.h"
+#include "config.h"
+
+using namespace std;
+
+// Hardware prefetcher of one cache. It sees the demand accesses that reach
+// the cache as physical line addresses (the address above the line offset)
+// and answers with the lines to prefetch, which never leave the page of the
+// access since the next physical page holds unrelated data. Hierarchy
+// installs them through the cache's normal replacement; the prefetcher
+// keeps the bookkeeping behind the counters of PrefetchStatistics:
+//  - next-line (tagged): a miss, or the first hit on a prefetched line,
+//    fetches the next degree lines
+//  - stride: per page, once two successive accesses moved by the same
+//    stride, fetches degree lines further along it
+//  - stream: a miss outside every stream starts one (the oldest of
+//    STREAMS is replaced), and each access to a line the stream fetched
+//    keeps it degree lines ahead of that access
+class Prefetcher
+{
+public:
+	Prefetcher(PrefetcherKind k, int d, int page_line_bits, int num_lines, int l)
+	{
+		kind = k;
+		degree = d;
+		page_lines = page_line_bits;
+		latency = l;
+		lines = num_lines;
+		issued_at = new unsigned long long[lines];
+		evicted = new uint64_t[lines];
+		for (int i = 0; i < lines; ++i) {
+			issued_at[i] = 0;
+			evicted[i] = 0;
+		}
+		for (int i = 0; i < TABLE_SIZE; ++i) {
+			table[i].valid = false;
+			table[i].used = 0;
+		}
+		clock = 0;
+	}
+	~Prefetcher()
+	{
+		delete[] issued_at;
+		delete[] evicted;
+	}
+	// a demand hit in cache line (way number) line_num at reference now;
+	// true on the first hit of a prefetched line, late if it came before the
+	// prefetch could have arrived
+	bool demandHit(unsigned int line_num, unsigned long long now, bool& late)
+	{
+		if (issued_at[line_num] == 0) {
+			return false;
+		}
+		late = (now - (issued_at[line_num] - 1) < static_cast<unsigned long long>(latency));
+		issued_at[line_num] = 0;
+		return true;
+	}
+	// a demand miss of line; true if a prefetch had evicted it
+	bool demandMiss(uint64_t line)
+	{
+		uint64_t& slot = evicted[line % lines];
+		if (slot == line + 1) {
+			slot = 0;
+			return true;
+		}
+		return false;
+	}
+	// a demand miss filled cache line line_num
+	void demandFill(unsigned int line_num)
+	{
+		issued_at[line_num] = 0;
+	}
+	// a prefetch of line at reference now filled cache line line_num, in
+	// place of replaced (a line address) when replaced_valid
+	void prefetchFill(unsigned int line_num, uint64_t line, uint64_t replaced, bool replaced_valid, unsigned long long now)
+	{
+		issued_at[line_num] = now + 1;
+		if (evicted[line % lines] == line + 1) {
+			evicted[line % lines] = 0;
+		}
+		if (replaced_valid) {
+			evicted[replaced % lines] = replaced + 1;
+		}
+	}
+	// the lines to prefetch after a demand access of line, at most degree
+	// of them written to candidates
+	int train(uint64_t line, bool miss, bool prefetched_hit, uint64_t *candidates)
+	{
+		switch (kind) {
+		case PREFETCH_NEXT_LINE:
+			return (miss || prefetched_hit) ? along(line, 1, candidates) : 0;
+		case PREFETCH_STRIDE:
+			return trainStride(line, candidates);
+		case PREFETCH_STREAM:
+			return trainStream(line, miss, candidates);
+		default:
+			return 0;
+		}
+	}
+	void save(CheckpointWriter& out)
+	{
+		out.write(issued_at, lines * sizeof(unsigned long long));
+		out.write(evicted, lines * sizeof(uint64_t));
+		out.write(table, sizeof(table));
+		out.write(&clock, sizeof(clock));
+	}
+	void restore(CheckpointReader& in)
+	{
+		in.read(issued_at, lines * sizeof(unsigned long long));
+		in.read(evicted, lines * sizeof(uint64_t));
+		in.read(table, sizeof(table));
+		in.read(&clock, sizeof(clock));
+	}
+private:
+	static const int TABLE_SIZE = 16; // pages of the stride prefetcher
+	static const int STREAMS = 8;
+
+	// a page the stride prefetcher follows, or a stream with its window of
+	// fetched lines [first, next)
+	struct TableEntry
+	{
+		bool valid;
+		uint64_t page;
+		uint64_t first;
+		uint64_t next;
+		int64_t stride;
+		unsigned long long used;
+	};
+
+	bool samePage(uint64_t a, uint64_t b)
+	{
+		return (a >> page_lines) == (b >> page_lines);
+	}
+	int along(uint64_t line, int64_t stride, uint64_t *candidates)
+	{
+		int n = 0;
+		uint64_t next = line;
+		while (n < degree) {
+			next += stride;
+			if (!samePage(next, line)) {
+				break;
+			}
+			candidates[n++] = next;
+		}
+		return n;
+	}
+	TableEntry *oldest(int size)
+	{
+		TableEntry *entry = &table[0];
+		for (int i = 1; i < size; ++i) {
+			if (!table[i].valid || (entry->valid && table[i].used < entry->used)) {
+				entry = &table[i];
+			}
+		}
+		return entry;
+	}
+	int trainStride(uint64_t line, uint64_t *candidates)
+	{
+		uint64_t page = line >> page_lines;
+		TableEntry *entry = nullptr;
+		for (int i = 0; i < TABLE_SIZE; ++i) {
+			if (table[i].valid && table[i].page == page) {
+				entry = &table[i];
+			}
+		}
+		if (entry == nullptr) {
+			entry = oldest(TABLE_SIZE);
+			entry->valid = true;
+			entry->page = page;
+			entry->next = line;
+			entry->stride = 0;
+			entry->used = ++clock;
+			return 0;
+		}
+		entry->used = ++clock;
+		int64_t stride = static_cast<int64_t>(line - entry->next);
+		if (stride == 0) {
+			return 0; // the same line again says nothing about the stride
+		}
+		entry->next = line; // the last line accessed
+		if (stride != entry->stride) {
+			entry->stride = stride;
+			return 0;
+		}
+		return along(line, stride, candidates);
+	}
+	int trainStream(uint64_t line, bool miss, uint64_t *candidates)
+	{
+		TableEntry *entry = nullptr;
+		for (int i = 0; i < STREAMS; ++i) {
+			if (table[i].valid && line >= table[i].first && line < table[i].next) {
+				entry = &table[i];
+			}
+		}
+		if (entry == nullptr) {
+			if (!miss) {
+				return 0;
+			}
+			entry = oldest(STREAMS);
+			entry->valid = true;
+			entry->next = line + 1;
+		}
+		entry->first = line + 1;
+		entry->used = ++clock;
+		int n = 0;
+		while (entry->next <= line + degree && samePage(entry->next, line)) {
+			candidates[n++] = entry->next++;
+		}
+		return n;
+	}
+
+	PrefetcherKind kind;
+	int degree;
+	int page_lines; // log2 of the lines per page
+	int latency; // references from the issue of a prefetch to its arrival
+	int lines; // of the cache
+	unsigned long long *issued_at; // per cache line, 1 + the reference a prefetch filled it at, 0 once demanded
+	uint64_t *evicted; // 1 + the lines prefetches evicted, hashed by line
+	TableEntry table[TABLE_SIZE];
+	unsigned long long clock; // table accesses, for the oldest entry
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Stage profiler of the simulation, built only with -DHIERARCHY_PROFILE.
+// Otherwise the PROFILE_ macros expand to nothing and their arguments are
+// never evaluated, so the hot path carries no trace of it.
+#ifdef HIERARCHY_PROFILE
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+enum ProfileStage
+{
+	STAGE_PARSE,
+	STAGE_TLB,
+	STAGE_PAGE_TABLE,
+	STAGE_INVALIDATION,
+	STAGE_CACHE,
+	STAGE_OUTPUT,
+	NUM_PROFILE_STAGES
+};
+
+inline uint64_t profileClock()
+{
+	// the time stamp counter where there is one, nanoseconds elsewhere
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct ProfileTimer
+{
+	uint64_t start;
+	uint64_t nested; // Profiler::nested when the timer started
+};
+
+class Profiler
+{
+public:
+	Profiler()
+	{
+		memset(events, 0, sizeof(events));
+		memset(ticks, 0, sizeof(ticks));
+		memset(histogram, 0, sizeof(histogram));
+		nested = 0;
+		start_time = chrono::steady_clock::now();
+		start_ticks = profileClock();
+	}
+	ProfileTimer start()
+	{
+		ProfileTimer timer = {profileClock(), nested};
+		return timer;
+	}
+	void stop(const ProfileTimer& timer, ProfileStage stage, unsigned long long n)
+	{
+		// n events took the time since start (n = 0 adds to the time of
+		// events counted elsewhere); stages stopped in between keep their
+		// own time, so nested stages are not counted twice
+		uint64_t elapsed = profileClock() - timer.start;
+		uint64_t own = elapsed - min(elapsed, nested - timer.nested);
+		nested += elapsed;
+		ticks[stage] += own;
+		if (n != 0) {
+			events[stage] += n;
+			histogram[stage][bucket(own / n)] += n;
+		}
+	}
+	void print(unsigned long long references)
+	{
+		static const char *names[NUM_PROFILE_STAGES] = {"parse", "tlb", "page table", "invalidation", "cache", "output"};
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+		uint64_t total = profileClock() - start_ticks;
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+
+		printf("\nProfile\n\n");
+		printf("%-13s %12s %14s %6s %9s %7s %7s %7s\n", "stage", "events", "ticks", "share", "mean", "p50", "p90", "p99");
+		for (int s = 0; s < NUM_PROFILE_STAGES; ++s) {
+			printf("%-13s %12llu %14llu %5.1f%% %9.1f %7llu %7llu %7llu\n", names[s], events[s], ticks[s], share(ticks[s], total),
+					(events[s] > 0) ? static_cast<double>(ticks[s]) / events[s] : 0.0, percentile(s, 0.5), percentile(s, 0.9), percentile(s, 0.99));
+		}
+		printf("\n%-17s: %f\n", "seconds", seconds);
+		printf("%-17s: %.0f\n", "ticks per second", (seconds > 0) ? total / seconds : 0.0);
+		printf("%-17s: %.0f\n", "references/sec", (seconds > 0) ? references / seconds : 0.0);
+		printf("%-17s: %ld KiB\n", "peak RSS", usage.ru_maxrss);
+
+		// ticks per event, as the share of events at or below 2^b - 1 ticks
+		printf("\nTicks per event\n");
+		for (int s = 0; s < NUM_PROFILE_STAGES; ++s) {
+			if (events[s] == 0) {
+				continue;
+			}
+			printf("\n%-13s", names[s]);
+			for (int b = 0; b < BUCKETS; ++b) {
+				if (histogram[s][b] != 0) {
+					printf(" <=%llu:%.1f%%", bucketLimit(b), share(histogram[s][b], events[s]));
+				}
+			}
+			printf("\n");
+		}
+	}
+private:
+	static const int BUCKETS = 65;
+
+	static int bucket(uint64_t t)
+	{
+		// bucket b holds 2^(b-1) ... 2^b - 1 ticks, bucket 0 holds 0
+		return (t == 0) ? 0 : 64 - __builtin_clzll(t);
+	}
+	static unsigned long long bucketLimit(int b)
+	{
+		return (b >= 64) ? UINT64_MAX : (1ull << b) - 1;
+	}
+	static double share(unsigned long long part, unsigned long long whole)
+	{
+		return (whole > 0) ? 100.0 * part / whole : 0.0;
+	}
+	unsigned long long percentile(int s, double p)
+	{
+		// upper bound of the bucket holding the given fraction of events
+		unsigned long long seen = 0;
+		for (int b = 0; b < BUCKETS; ++b) {
+			seen += histogram[s][b];
+			if (seen > 0 && seen >= p * events[s]) {
+				return bucketLimit(b);
+			}
+		}
+		return 0;
+	}
+
+	unsigned long long events[NUM_PROFILE_STAGES];
+	unsigned long long ticks[NUM_PROFILE_STAGES];
+	unsigned long long histogram[NUM_PROFILE_STAGES][BUCKETS];
+	uint64_t nested; // ticks of every stopped stage so far
+	chrono::steady_clock::time_point start_time;
+	uint64_t start_ticks;
+};
+
+#define PROFILE_START(profiler, timer) ProfileTimer timer = (profiler).start()
+#define PROFILE_STOP(profiler, timer, stage, n) (profiler).stop(timer, stage, n)
+
+#else
+
+#define PROFILE_START(profiler, timer)
+#define PROFILE_STOP(profiler, timer, stage, n)
+
+#endif
+
+#endif
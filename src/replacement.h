@@ -0,0 +1,299 @@
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include <cstdint>
+#include "checkpoint.h"
+#include "config.h"
+
+using namespace std;
+
+// the structures with a replacement policy, which draw their random
+// numbers from separate generators of one configured seed
+enum ReplacementStructure
+{
+	STRUCTURE_INSTRUCTION_TLB,
+	STRUCTURE_DATA_TLB,
+	STRUCTURE_FRAMES,
+	STRUCTURE_INSTRUCTION_CACHE,
+	STRUCTURE_DATA_CACHE,
+	NUM_REPLACEMENT_STRUCTURES
+};
+
+// state a policy keeps per structure rather than per set: the generator
+// the random policy and BRRIP draw from
+class ReplacementContext
+{
+public:
+	ReplacementContext(uint64_t seed, ReplacementStructure structure)
+	{
+		// splitmix64 of the seed; xorshift must not start from zero
+		uint64_t z = seed * NUM_REPLACEMENT_STRUCTURES + structure + 0x9e3779b97f4a7c15ull;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		random = z ^ (z >> 31);
+		if (random == 0) {
+			random = 1;
+		}
+	}
+	uint64_t next()
+	{
+		random ^= random << 13;
+		random ^= random >> 7;
+		random ^= random << 17;
+		return random;
+	}
+	void save(CheckpointWriter& out)
+	{
+		out.write(&random, sizeof(random));
+	}
+	void restore(CheckpointReader& in)
+	{
+		in.read(&random, sizeof(random));
+	}
+
+	uint64_t random;
+};
+
+// Every policy keeps one byte of state per way of a set (state[0 ... n-1])
+// and is used through four static functions: reset for a new set, hit when a
+// way is found, victim for the way a fill replaces (which may update the
+// state), and fill once the new line is in that way. The way count n is a
+// constant wherever the caller's associativity is one.
+
+class LRUReplacement
+{
+public:
+	// state is the age of each way, 0 = MRU and n-1 = LRU
+	static void reset(unsigned char *state, int n)
+	{
+		for (int i = 0; i < n; ++i) {
+			state[i] = n - 1 - i; // way 0 starts as LRU
+		}
+	}
+	static void hit(unsigned char *state, int n, int way)
+	{
+		// every way more recent than the touched one ages by one
+		unsigned char age = state[way];
+		for (int i = 0; i < n; ++i) {
+			if (state[i] < age) {
+				++state[i];
+			}
+		}
+		state[way] = 0;
+	}
+	static int victim(unsigned char *state, int n, ReplacementContext&)
+	{
+		int i = 0;
+		while (state[i] != n - 1) {
+			++i;
+		}
+		return i;
+	}
+	static void fill(unsigned char *state, int n, int way, ReplacementContext&)
+	{
+		hit(state, n, way);
+	}
+};
+
+class FIFOReplacement
+{
+public:
+	// LRU ages that only a fill updates
+	static void reset(unsigned char *state, int n)
+	{
+		LRUReplacement::reset(state, n);
+	}
+	static void hit(unsigned char*, int, int)
+	{
+	}
+	static int victim(unsigned char *state, int n, ReplacementContext& context)
+	{
+		return LRUReplacement::victim(state, n, context);
+	}
+	static void fill(unsigned char *state, int n, int way, ReplacementContext&)
+	{
+		LRUReplacement::hit(state, n, way);
+	}
+};
+
+class TreePLRUReplacement
+{
+public:
+	// a binary tree over the ways (n a power of two) with its n-1 nodes in
+	// heap order at bits 1 ... n-1 of one bit vector, packed into the first
+	// state bytes; each node points to its colder half, 0 left and 1 right
+	static void reset(unsigned char *state, int n)
+	{
+		for (int i = 0; i < n; ++i) {
+			state[i] = 0;
+		}
+	}
+	static void hit(unsigned char *state, int n, int way)
+	{
+		// point every node on the way's path away from it
+		for (int node = way + n; node > 1; node /= 2) {
+			int parent = node / 2;
+			unsigned char bit = 1 << (parent & 7);
+			state[parent >> 3] = (node & 1) ? (state[parent >> 3] & ~bit) : (state[parent >> 3] | bit);
+		}
+	}
+	static int victim(unsigned char *state, int n, ReplacementContext&)
+	{
+		int node = 1;
+		while (node < n) {
+			node = 2 * node + ((state[node >> 3] >> (node & 7)) & 1);
+		}
+		return node - n;
+	}
+	static void fill(unsigned char *state, int n, int way, ReplacementContext&)
+	{
+		hit(state, n, way);
+	}
+};
+
+class BitPLRUReplacement
+{
+public:
+	// one MRU bit per way; when the last one is set the others are cleared
+	static void reset(unsigned char *state, int n)
+	{
+		for (int i = 0; i < n; ++i) {
+			state[i] = 0;
+		}
+	}
+	static void hit(unsigned char *state, int n, int way)
+	{
+		if (state[way] != 0) {
+			return;
+		}
+		state[way] = 1;
+		for (int i = 0; i < n; ++i) {
+			if (state[i] == 0) {
+				return;
+			}
+		}
+		for (int i = 0; i < n; ++i) {
+			state[i] = (i == way) ? 1 : 0;
+		}
+	}
+	static int victim(unsigned char *state, int n, ReplacementContext&)
+	{
+		for (int i = 0; i < n; ++i) {
+			if (state[i] == 0) {
+				return i;
+			}
+		}
+		return 0; // a single way
+	}
+	static void fill(unsigned char *state, int n, int way, ReplacementContext&)
+	{
+		hit(state, n, way);
+	}
+};
+
+class SRRIPReplacement
+{
+public:
+	// 2-bit re-reference prediction values: a hit predicts a near re-use
+	// (0), a fill a long one (2), and the victim is the first way predicted
+	// distant (3), ageing every way until there is one
+	static const unsigned char DISTANT = 3;
+
+	static void reset(unsigned char *state, int n)
+	{
+		for (int i = 0; i < n; ++i) {
+			state[i] = DISTANT;
+		}
+	}
+	static void hit(unsigned char *state, int, int way)
+	{
+		state[way] = 0;
+	}
+	static int victim(unsigned char *state, int n, ReplacementContext&)
+	{
+		for (;;) {
+			for (int i = 0; i < n; ++i) {
+				if (state[i] == DISTANT) {
+					return i;
+				}
+			}
+			for (int i = 0; i < n; ++i) {
+				++state[i];
+			}
+		}
+	}
+	static void fill(unsigned char *state, int, int way, ReplacementContext&)
+	{
+		state[way] = DISTANT - 1;
+	}
+};
+
+class BRRIPReplacement
+{
+public:
+	// SRRIP that fills as distant, except for one fill in 32 on average,
+	// drawn from the structure's seeded generator
+	static const uint64_t LONG_FILL_INTERVAL = 32;
+
+	static void reset(unsigned char *state, int n)
+	{
+		SRRIPReplacement::reset(state, n);
+	}
+	static void hit(unsigned char *state, int n, int way)
+	{
+		SRRIPReplacement::hit(state, n, way);
+	}
+	static int victim(unsigned char *state, int n, ReplacementContext& context)
+	{
+		return SRRIPReplacement::victim(state, n, context);
+	}
+	static void fill(unsigned char *state, int, int way, ReplacementContext& context)
+	{
+		state[way] = (context.next() % LONG_FILL_INTERVAL == 0) ? SRRIPReplacement::DISTANT - 1 : SRRIPReplacement::DISTANT;
+	}
+};
+
+class RandomReplacement
+{
+public:
+	// a victim drawn from the structure's seeded generator, no state per set
+	static void reset(unsigned char *state, int n)
+	{
+		for (int i = 0; i < n; ++i) {
+			state[i] = 0;
+		}
+	}
+	static void hit(unsigned char*, int, int)
+	{
+	}
+	static int victim(unsigned char*, int n, ReplacementContext& context)
+	{
+		return (n == 1) ? 0 : context.next() % n;
+	}
+	static void fill(unsigned char*, int, int, ReplacementContext&)
+	{
+	}
+};
+
+// whether a filled way is left as a hit would leave it; otherwise the hit
+// after a fill still changes the set and may not be memoized
+inline bool fillLeavesHitState(ReplacementPolicy p)
+{
+	return p != POLICY_SRRIP && p != POLICY_BRRIP;
+}
+
+// the policy-specific statement given as the remaining arguments, with POLICY naming the policy class
+// of the runtime value p; each case is inlined, so the hot path of a
+// structure pays one well predicted branch for its policy
+#define REPLACEMENT_DISPATCH(p, ...) \
+	switch (p) { \
+	case POLICY_TREE_PLRU: { typedef TreePLRUReplacement POLICY; __VA_ARGS__; } break; \
+	case POLICY_BIT_PLRU: { typedef BitPLRUReplacement POLICY; __VA_ARGS__; } break; \
+	case POLICY_SRRIP: { typedef SRRIPReplacement POLICY; __VA_ARGS__; } break; \
+	case POLICY_BRRIP: { typedef BRRIPReplacement POLICY; __VA_ARGS__; } break; \
+	case POLICY_FIFO: { typedef FIFOReplacement POLICY; __VA_ARGS__; } break; \
+	case POLICY_RANDOM: { typedef RandomReplacement POLICY; __VA_ARGS__; } break; \
+	default: { typedef LRUReplacement POLICY; __VA_ARGS__; } break; \
+	}
+
+#endif
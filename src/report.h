@@ -0,0 +1,254 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "config.h"
+#include "error.h"
+
+using namespace std;
+
+enum AccessResult : uint8_t
+{
+	RESULT_NONE,
+	RESULT_HIT,
+	RESULT_MISS
+};
+
+// one row of the per-reference table; this is also the record written by the
+// binary report mode, so its layout must not change without bumping the version
+struct ReferenceReport
+{
+	uint64_t address;
+	uint64_t virtual_page_num;
+	uint64_t page_offset;
+	uint64_t tlb_tag;
+	uint64_t cache_tag;
+	uint32_t tlb_index;
+	uint32_t physical_page_num;
+	uint32_t cache_index;
+	char stream_type;
+	AccessResult tlb_result;
+	AccessResult pt_result;
+	AccessResult cache_result;
+};
+
+struct ReportFileHeader
+{
+	char magic[4]; // "HREP"
+	uint32_t version;
+	uint8_t virtual_addresses_enabled;
+	uint8_t tlbs_enabled;
+	uint8_t reserved[2];
+};
+
+const uint32_t REPORT_FILE_VERSION = 2;
+
+class ReportWriter
+{
+public:
+	virtual ~ReportWriter()
+	{
+	}
+	virtual void writeHeader() = 0;
+	virtual void writeReference(const ReferenceReport& report) = 0;
+	virtual void flush() = 0;
+	// flushes the report and throws if any of it failed to reach its file,
+	// which the destructor cannot
+	virtual void close()
+	{
+		flush();
+	}
+};
+
+class TextReportWriter : public ReportWriter
+{
+public:
+	TextReportWriter(const Config& c) : config(c)
+	{
+		buffer = new char[BUFFER_SIZE];
+		end = buffer;
+	}
+	~TextReportWriter()
+	{
+		flush();
+		delete[] buffer;
+	}
+	void writeHeader()
+	{
+		if (config.virtual_addresses_enabled) {
+			printf("%-8s %-7s %-6s %-4s %-7s %-5s %-4s %-4s %-6s %-7s %-5s %-4s\n", "Virtual", "Virtual", "Page", "Ref", "TLB", "TLB", "TLB", "PT", "Phys", "Cache", "Cache", "Cache");
+		} else {
+			printf("%-8s %-7s %-6s %-4s %-7s %-5s %-4s %-4s %-6s %-7s %-5s %-4s\n", "Physical", "Virtual", "Page", "Ref", "TLB", "TLB", "TLB", "PT", "Phys", "Cache", "Cache", "Cache");
+		}
+		printf("%-8s %-7s %-6s %-4s %-7s %-5s %-4s %-4s %-6s %-7s %-5s %-4s\n", "Address", "Page #", "Offset", "Type", "Tag", "Index", "Ref", "Ref", "Page #", "Tag", "Index", "Ref");
+		printf("%-8s %-7s %-6s %-4s %-7s %-5s %-4s %-4s %-6s %-7s %-5s %-4s\n", "--------", "-------", "------", "----", "-------", "-----", "----", "----", "------", "-------", "-----", "-----");
+	}
+	void writeReference(const ReferenceReport& report)
+	{
+		// same layout as "%08lx %7lx %6lx %-4s %7lx %5x %-4s %-4s %6x %7lx %5x %-4s\n"
+		if (end + MAX_LINE > buffer + BUFFER_SIZE) {
+			flush();
+		}
+		char *p = end;
+		p = putHex(p, report.address, 8, '0');
+		if (config.virtual_addresses_enabled) {
+			p = putHex(p, report.virtual_page_num, 7, ' ');
+		} else {
+			p = putBlank(p, 7);
+		}
+		p = putHex(p, report.page_offset, 6, ' ');
+		p = putText(p, (report.stream_type == 'I') ? "inst" : "data", 4);
+		if (config.tlbs_enabled) {
+			p = putHex(p, report.tlb_tag, 7, ' ');
+			p = putHex(p, report.tlb_index, 5, ' ');
+			p = putText(p, resultText(report.tlb_result), 4);
+		} else {
+			p = putBlank(p, 7);
+			p = putBlank(p, 5);
+			p = putBlank(p, 4);
+		}
+		if (config.virtual_addresses_enabled) {
+			p = putText(p, resultText(report.pt_result), 4);
+		} else {
+			p = putBlank(p, 4);
+		}
+		p = putHex(p, report.physical_page_num, 6, ' ');
+		p = putHex(p, report.cache_tag, 7, ' ');
+		p = putHex(p, report.cache_index, 5, ' ');
+		p = putText(p, resultText(report.cache_result), 4);
+		p[-1] = '\n'; // replaces the column separator
+		end = p;
+	}
+	void flush()
+	{
+		fwrite(buffer, 1, end - buffer, stdout);
+		end = buffer;
+	}
+private:
+	static const size_t BUFFER_SIZE = 1 << 20;
+	static const size_t MAX_LINE = 192;
+
+	static const char *resultText(AccessResult result)
+	{
+		switch (result) {
+		case RESULT_HIT:
+			return "hit";
+		case RESULT_MISS:
+			return "miss";
+		default:
+			return "none";
+		}
+	}
+	// each put* helper writes one column followed by a separating space
+	static char *putHex(char *p, uint64_t value, int width, char pad)
+	{
+		char digits[16];
+		int n = 0;
+		do {
+			digits[n++] = "0123456789abcdef"[value & 0xf];
+			value >>= 4;
+		} while (value != 0);
+		for (int i = n; i < width; ++i) {
+			*p++ = pad;
+		}
+		while (n > 0) {
+			*p++ = digits[--n];
+		}
+		*p++ = ' ';
+		return p;
+	}
+	static char *putText(char *p, const char *text, int width)
+	{
+		int n = 0;
+		while (text[n] != '\0') {
+			*p++ = text[n++];
+		}
+		for (; n < width; ++n) {
+			*p++ = ' ';
+		}
+		*p++ = ' ';
+		return p;
+	}
+	static char *putBlank(char *p, int width)
+	{
+		memset(p, ' ', width + 1);
+		return p + width + 1;
+	}
+
+	const Config& config;
+	char *buffer;
+	char *end;
+};
+
+class BinaryReportWriter : public ReportWriter
+{
+public:
+	BinaryReportWriter(const Config& c, string filename) : config(c)
+	{
+		out = fopen(filename.c_str(), "wb");
+		if (out == nullptr) {
+			throwError("failed to open %s for writing", filename.c_str());
+		}
+		records = new ReferenceReport[BATCH_SIZE];
+		count = 0;
+	}
+	~BinaryReportWriter()
+	{
+		if (out != nullptr) {
+			// not closed, so a failure here goes unreported
+			fwrite(records, sizeof(ReferenceReport), count, out);
+			fclose(out);
+		}
+		delete[] records;
+	}
+	void writeHeader()
+	{
+		ReportFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "HREP", 4);
+		header.version = REPORT_FILE_VERSION;
+		header.virtual_addresses_enabled = config.virtual_addresses_enabled;
+		header.tlbs_enabled = config.tlbs_enabled;
+		if (fwrite(&header, sizeof(header), 1, out) < 1) {
+			throwError("failed to write binary report");
+		}
+	}
+	void writeReference(const ReferenceReport& report)
+	{
+		if (count == BATCH_SIZE) {
+			flush();
+		}
+		records[count++] = report;
+	}
+	void flush()
+	{
+		bool failed = fwrite(records, sizeof(ReferenceReport), count, out) < count;
+		count = 0;
+		if (failed) {
+			throwError("failed to write binary report");
+		}
+	}
+	void close()
+	{
+		flush();
+		bool failed = ferror(out) != 0;
+		failed = (fclose(out) != 0) || failed;
+		out = nullptr;
+		if (failed) {
+			throwError("failed to write binary report");
+		}
+	}
+private:
+	static const size_t BATCH_SIZE = 16384;
+
+	const Config& config;
+	FILE *out;
+	ReferenceReport *records;
+	size_t count;
+};
+
+#endif
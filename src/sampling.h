@@ -0,0 +1,111 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <climits>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+class SetSample
+{
+public:
+	// the sets of one cache or TLB that a sampled run simulates, and the
+	// references, misses and memory traffic each of them saw. Set indices are
+	// scrambled by an odd multiplier, a permutation of the index range, so the
+	// sampled sets are spread out rather than evenly strided
+	SetSample(int s, int rate)
+	{
+		num_sets = s;
+		num_sampled = max(1, num_sets / rate);
+		slots = new unsigned int[num_sets];
+		int k = 0;
+		for (int i = 0; i < num_sets; ++i) {
+			slots[i] = UINT_MAX;
+			if (((i * 0x9E3779B1u) & (num_sets - 1)) < (unsigned int)num_sampled) {
+				slots[i] = k++;
+			}
+		}
+		set_references = new unsigned long long[num_sampled]();
+		set_misses = new unsigned long long[num_sampled]();
+		references = 0;
+		misses = 0;
+		traffic = 0;
+	}
+	~SetSample()
+	{
+		delete[] slots;
+		delete[] set_references;
+		delete[] set_misses;
+	}
+	bool contains(unsigned int index)
+	{
+		return slots[index] != UINT_MAX;
+	}
+	void count(unsigned int index, bool miss, unsigned long long memory_refs)
+	{
+		++set_references[slots[index]];
+		++references;
+		if (miss) {
+			++set_misses[slots[index]];
+			++misses;
+		}
+		traffic += memory_refs;
+	}
+	void addTraffic(unsigned long long memory_refs)
+	{
+		traffic += memory_refs;
+	}
+	double missRatio()
+	{
+		return (references > 0) ? static_cast<double>(misses) / references : 0.0;
+	}
+	unsigned long long estimateMisses(unsigned long long total_references)
+	{
+		// ratio estimate: the sampled miss ratio applied to every reference
+		return llround(missRatio() * total_references);
+	}
+	unsigned long long estimateTraffic(unsigned long long total_references)
+	{
+		return (references > 0) ? llround(static_cast<double>(traffic) * total_references / references) : 0;
+	}
+	double confidenceHalfWidth()
+	{
+		// 95% interval of the miss ratio, treating the sampled sets as a cluster
+		// sample of all sets; negative when it cannot be estimated
+		if (num_sampled == num_sets) {
+			return 0.0;
+		}
+		if (num_sampled < 2 || references == 0) {
+			return -1.0;
+		}
+		double ratio = missRatio();
+		double mean_references = static_cast<double>(references) / num_sampled;
+		double sum_squares = 0.0;
+		for (int i = 0; i < num_sampled; ++i) {
+			double residual = static_cast<double>(set_misses[i]) - ratio * set_references[i];
+			sum_squares += residual * residual;
+		}
+		double variance = (1.0 - static_cast<double>(num_sampled) / num_sets) * sum_squares / (num_sampled - 1) / (num_sampled * mean_references * mean_references);
+		return 1.96 * sqrt(variance);
+	}
+	int sampledSets()
+	{
+		return num_sampled;
+	}
+	int sets()
+	{
+		return num_sets;
+	}
+private:
+	int num_sets;
+	int num_sampled;
+	unsigned int *slots;
+	unsigned long long *set_references;
+	unsigned long long *set_misses;
+	unsigned long long references;
+	unsigned long long misses;
+	unsigned long long traffic;
+};
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef SHARDS_H
+#define SHARDS_H
+
+#include <cstdint>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cache.h"
+#include "config.h"
+#include "report.h"
+#include "statistics.h"
+
+using namespace std;
+
+enum ShardAccessType : uint8_t
+{
+	SHARD_INSTRUCTION,
+	SHARD_READ,
+	SHARD_WRITE,
+	SHARD_INVALIDATE
+};
+
+struct ShardAccess
+{
+	uint64_t tag;
+	unsigned int index; // set index within the owning shard
+	unsigned int phys_page_num;
+	ShardAccessType type;
+	AccessResult result;
+};
+
+class CacheShards
+{
+public:
+	// The I-cache and D-cache split into num_shards interleaved groups of sets
+	// (shard = set index modulo num_shards), each a Cache of its own owned by
+	// one thread. Hierarchy translates a batch serially and queues the cache
+	// accesses and page invalidations in trace order; run() then replays each
+	// shard's accesses, and every invalidation, on that shard's thread. Sets
+	// never interact, so the outcome is the same as a serial simulation.
+	CacheShards(const Config& c, int n) : config(c)
+	{
+		num_shards = n;
+		shard_bits = __builtin_ctz(num_shards);
+		for (int s = 0; s < num_shards; ++s) {
+			instruction_caches.push_back(new Cache(config.instruction_cache_sets / num_shards, config.instruction_cache_set_size, config.physical_pages, "instruction", config.instruction_cache_policy, ReplacementContext(config.replacement_seed, STRUCTURE_INSTRUCTION_CACHE)));
+			data_caches.push_back(new Cache(config.data_cache_sets / num_shards, config.data_cache_set_size, config.physical_pages, "data", config.data_cache_policy, ReplacementContext(config.replacement_seed, STRUCTURE_DATA_CACHE)));
+		}
+		shard_accesses.resize(num_shards);
+		shard_counts.resize(num_shards);
+		kernel = selectKernel();
+		stopping = false;
+		generation = 0;
+		pending = 0;
+		for (int s = 1; s < num_shards; ++s) {
+			workers.push_back(thread(&CacheShards::work, this, s));
+		}
+	}
+	~CacheShards()
+	{
+		{
+			lock_guard<mutex> lock(work_mutex);
+			stopping = true;
+		}
+		work_ready.notify_all();
+		for (size_t t = 0; t < workers.size(); ++t) {
+			workers[t].join();
+		}
+		for (int s = 0; s < num_shards; ++s) {
+			delete instruction_caches[s];
+			delete data_caches[s];
+		}
+	}
+	void queueAccess(ShardAccessType type, unsigned int index, uint64_t tag, unsigned int phys_page_num)
+	{
+		ShardAccess access;
+		access.tag = tag;
+		access.index = index >> shard_bits;
+		access.phys_page_num = phys_page_num;
+		access.type = type;
+		access.result = RESULT_NONE;
+		shard_accesses[index & (num_shards - 1)].push_back(accesses.size());
+		accesses.push_back(access);
+	}
+	void queueInvalidation(unsigned int phys_page_num)
+	{
+		ShardAccess access;
+		access.tag = 0;
+		access.index = 0;
+		access.phys_page_num = phys_page_num;
+		access.type = SHARD_INVALIDATE;
+		access.result = RESULT_NONE;
+		for (int s = 0; s < num_shards; ++s) {
+			shard_accesses[s].push_back(accesses.size());
+		}
+		accesses.push_back(access);
+	}
+	void queueRow(const ReferenceReport& row)
+	{
+		rows.push_back(row);
+	}
+	void run(Statistics& stats, ReportWriter *report)
+	{
+		// replays everything queued on the shard threads, with this thread as
+		// shard 0, adds the cache counters to stats and writes the queued rows
+		if (!accesses.empty()) {
+			{
+				lock_guard<mutex> lock(work_mutex);
+				pending = num_shards - 1;
+				++generation;
+			}
+			work_ready.notify_all();
+			(this->*kernel)(0);
+			unique_lock<mutex> lock(work_mutex);
+			work_done.wait(lock, [this]() { return pending == 0; });
+		}
+		for (int s = 0; s < num_shards && !accesses.empty(); ++s) {
+			stats.ic_hits += shard_counts[s].ic_hits;
+			stats.ic_misses += shard_counts[s].ic_misses;
+			stats.dc_hits += shard_counts[s].dc_hits;
+			stats.dc_misses += shard_counts[s].dc_misses;
+			stats.memory_refs += shard_counts[s].memory_refs;
+			shard_accesses[s].clear();
+		}
+		if (report != nullptr) {
+			size_t a = 0;
+			for (size_t r = 0; r < rows.size(); ++r, ++a) {
+				while (accesses[a].type == SHARD_INVALIDATE) {
+					++a;
+				}
+				rows[r].cache_result = accesses[a].result;
+				report->writeReference(rows[r]);
+			}
+		}
+		accesses.clear();
+		rows.clear();
+	}
+private:
+	typedef void (CacheShards::*Kernel)(int);
+
+	struct ShardCounts
+	{
+		// padded so that the shards do not write to the same cache line
+		alignas(64) unsigned long long ic_hits;
+		unsigned long long ic_misses;
+		unsigned long long dc_hits;
+		unsigned long long dc_misses;
+		unsigned long long memory_refs;
+	};
+
+	void work(int shard)
+	{
+		unsigned long seen = 0;
+		while (true) {
+			{
+				unique_lock<mutex> lock(work_mutex);
+				work_ready.wait(lock, [&]() { return stopping || generation != seen; });
+				if (stopping) {
+					return;
+				}
+				seen = generation;
+			}
+			(this->*kernel)(shard);
+			lock_guard<mutex> lock(work_mutex);
+			if (--pending == 0) {
+				work_done.notify_one();
+			}
+		}
+	}
+
+	// the cache half of Hierarchy::simulateKernel for the accesses of one shard
+	template <bool WRITE_THROUGH, int CACHE_WAYS>
+	void simulateShard(int shard)
+	{
+		Cache *instruction_cache = instruction_caches[shard];
+		Cache *data_cache = data_caches[shard];
+		const vector<unsigned int>& positions = shard_accesses[shard];
+		ShardCounts counts;
+		memset(&counts, 0, sizeof(counts));
+
+		for (size_t i = 0; i < positions.size(); ++i) {
+			ShardAccess& access = accesses[positions[i]];
+			if (access.type == SHARD_INVALIDATE) {
+				int invalidated_dirty_count = data_cache->invalidateEntries(access.phys_page_num);
+				if (!WRITE_THROUGH) {
+					counts.memory_refs += invalidated_dirty_count;
+				}
+				instruction_cache->invalidateEntries(access.phys_page_num);
+			} else if (access.type == SHARD_INSTRUCTION) {
+				if (instruction_cache->readEntry<CACHE_WAYS>(access.index, access.tag)) {
+					access.result = RESULT_HIT;
+					++counts.ic_hits;
+				} else {
+					access.result = RESULT_MISS;
+					++counts.ic_misses;
+					++counts.memory_refs;
+					instruction_cache->addEntry<CACHE_WAYS>(access.index, access.tag, access.phys_page_num, 0);
+				}
+			} else {
+				bool is_write = (access.type == SHARD_WRITE);
+				if (data_cache->readEntry<CACHE_WAYS>(access.index, access.tag)) {
+					access.result = RESULT_HIT;
+					++counts.dc_hits;
+					if (is_write) {
+						if (WRITE_THROUGH) {
+							++counts.memory_refs;
+						} else {
+							data_cache->updateDirtyEntry<CACHE_WAYS>(access.index, access.tag);
+						}
+					}
+				} else {
+					access.result = RESULT_MISS;
+					++counts.dc_misses;
+					if (WRITE_THROUGH) {
+						++counts.memory_refs;
+						if (!is_write) {
+							data_cache->addEntry<CACHE_WAYS>(access.index, access.tag, access.phys_page_num, 0);
+						}
+					} else {
+						bool is_dirty = data_cache->addEntry<CACHE_WAYS>(access.index, access.tag, access.phys_page_num, is_write ? 1 : 0) && is_write;
+						counts.memory_refs += is_dirty ? 2 : 1;
+					}
+				}
+			}
+		}
+		shard_counts[shard] = counts;
+	}
+	Kernel selectKernel()
+	{
+		if (config.data_cache_write_through) {
+			return selectCacheWays<true>();
+		}
+		return selectCacheWays<false>();
+	}
+	template <bool WRITE_THROUGH>
+	Kernel selectCacheWays()
+	{
+		if (config.instruction_cache_set_size == config.data_cache_set_size) {
+			switch (config.data_cache_set_size) {
+			case 1:
+				return &CacheShards::simulateShard<WRITE_THROUGH, 1>;
+			case 2:
+				return &CacheShards::simulateShard<WRITE_THROUGH, 2>;
+			case 4:
+				return &CacheShards::simulateShard<WRITE_THROUGH, 4>;
+			case 8:
+				return &CacheShards::simulateShard<WRITE_THROUGH, 8>;
+			}
+		}
+		return &CacheShards::simulateShard<WRITE_THROUGH, 0>;
+	}
+
+	const Config& config;
+	int num_shards;
+	int shard_bits;
+	vector<Cache*> instruction_caches;
+	vector<Cache*> data_caches;
+	vector<ShardAccess> accesses;
+	vector<vector<unsigned int>> shard_accesses;
+	vector<ShardCounts> shard_counts;
+	vector<ReferenceReport> rows;
+	Kernel kernel;
+	vector<thread> workers;
+	mutex work_mutex;
+	condition_variable work_ready;
+	condition_variable work_done;
+	bool stopping;
+	unsigned long generation;
+	int pending;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <string>
+#include "statistics.h"
+using namespace std;
+
+void printPrefetchStatistics(const char *cache, const PrefetchStatistics& prefetches, unsigned long long misses)
+{
+	// accuracy is the share of prefetches that were used, coverage the share
+	// of the misses without prefetching that they removed
+	string name = cache;
+	printf("%-17s: %llu\n", (name + " prefetches").c_str(), prefetches.issued);
+	printf("%-17s: %llu\n", (name + " pf useful").c_str(), prefetches.useful);
+	printf("%-17s: %llu\n", (name + " pf late").c_str(), prefetches.late);
+	printf("%-17s: %llu\n", (name + " pf polluting").c_str(), prefetches.polluting);
+	printf("%-17s: ", (name + " pf accuracy").c_str());
+	if (prefetches.issued > 0) {
+		printf("%f\n", static_cast<double>(prefetches.useful) / prefetches.issued);
+	} else {
+		printf("N/A\n");
+	}
+	printf("%-17s: ", (name + " pf coverage").c_str());
+	if (prefetches.useful > 0 || misses > 0) {
+		printf("%f\n\n", static_cast<double>(prefetches.useful) / (prefetches.useful + misses));
+	} else {
+		printf("N/A\n\n");
+	}
+}
+
+void printStatistics(const Config& config, const Statistics& stats)
+{
+	printf("\nSimulation statistics\n\n");
+
+	printf("%-17s: %llu\n", "itlb hits", stats.itlb_hits);
+	printf("%-17s: %llu\n", "itlb misses", stats.itlb_misses);
+	printf("%-17s: ", "itlb hit ratio");
+	if (config.tlbs_enabled && (stats.itlb_hits > 0 || stats.itlb_misses > 0)) {
+		printf("%f\n\n", static_cast<double>(stats.itlb_hits) / (stats.itlb_hits + stats.itlb_misses));
+	} else {
+		printf("N/A\n\n");
+	}
+
+	printf("%-17s: %llu\n", "dtlb hits", stats.dtlb_hits);
+	printf("%-17s: %llu\n", "dtlb misses", stats.dtlb_misses);
+	printf("%-17s: ", "dtlb hit ratio");
+	if (config.tlbs_enabled && (stats.dtlb_hits > 0 || stats.dtlb_misses > 0)) {
+		printf("%f\n\n", static_cast<double>(stats.dtlb_hits) / (stats.dtlb_hits + stats.dtlb_misses));
+	} else {
+		printf("N/A\n\n");
+	}
+
+	printf("%-17s: %llu\n", "pt hits", stats.pt_hits);
+	printf("%-17s: %llu\n", "pt faults", stats.pt_faults);
+	printf("%-17s: ", "pt hit ratio");
+	if (config.virtual_addresses_enabled && (stats.pt_hits > 0 || stats.pt_faults > 0)) {
+		printf("%f\n\n", static_cast<double>(stats.pt_hits) / (stats.pt_hits + stats.pt_faults));
+	} else {
+		printf("N/A\n\n");
+	}
+
+	printf("%-17s: %llu\n", "ic hits", stats.ic_hits);
+	printf("%-17s: %llu\n", "ic misses", stats.ic_misses);
+	printf("%-17s: ", "ic hit ratio");
+	if (stats.ic_hits > 0 || stats.ic_misses > 0) {
+		printf("%f\n\n", static_cast<double>(stats.ic_hits) / (stats.ic_hits + stats.ic_misses));
+	} else {
+		printf("N/A\n\n");
+	}
+	if (config.instruction_prefetcher != PREFETCH_NONE) {
+		printPrefetchStatistics("ic", stats.ic_prefetches, stats.ic_misses);
+	}
+
+	printf("%-17s: %llu\n", "dc hits", stats.dc_hits);
+	printf("%-17s: %llu\n", "dc misses", stats.dc_misses);
+	printf("%-17s: ", "dc hit ratio");
+	if (stats.dc_hits > 0 || stats.dc_misses > 0) {
+		printf("%f\n\n", static_cast<double>(stats.dc_hits) / (stats.dc_hits + stats.dc_misses));
+	} else {
+		printf("N/A\n\n");
+	}
+	if (config.data_prefetcher != PREFETCH_NONE) {
+		printPrefetchStatistics("dc", stats.dc_prefetches, stats.dc_misses);
+	}
+
+	printf("%-17s: %llu\n", "Total reads", stats.reads);
+	printf("%-17s: %llu\n", "Total writes", stats.writes);
+	printf("%-17s: ", "Ratio of reads");
+	if (stats.reads > 0 || stats.writes > 0) {
+		printf("%f\n\n", static_cast<double>(stats.reads) / (stats.reads + stats.writes));
+	} else {
+		printf("N/A\n\n");
+	}
+
+	printf("%-17s: %llu\n", "Total inst refs", stats.inst_refs);
+	printf("%-17s: %llu\n", "Total data refs", stats.data_refs);
+	printf("%-17s: ", "Ratio of insts");
+	if (stats.inst_refs > 0 || stats.data_refs > 0) {
+		printf("%f\n\n", static_cast<double>(stats.inst_refs) / (stats.inst_refs + stats.data_refs));
+	} else {
+		printf("N/A\n\n");
+	}
+
+	printf("%-17s: %llu\n", "main memory refs", stats.memory_refs);
+	printf("%-17s: %llu\n", "disk refs", stats.disk_refs);
+
+	for (int k = 0; k < config.lower_levels; ++k) {
+		const LevelStatistics& level = stats.levels[k];
+		string name = "L" + to_string(k + 2);
+		printf("\n%-17s: %llu\n", (name + " hits").c_str(), level.hits);
+		printf("%-17s: %llu\n", (name + " misses").c_str(), level.misses);
+		printf("%-17s: ", (name + " hit ratio").c_str());
+		if (level.hits > 0 || level.misses > 0) {
+			printf("%f\n", static_cast<double>(level.hits) / (level.hits + level.misses));
+		} else {
+			printf("N/A\n");
+		}
+		printf("%-17s: %llu\n", (name + " writes").c_str(), level.writes);
+		printf("%-17s: %llu\n", (name + " traffic").c_str(), level.traffic);
+	}
+
+	if (config.write_buffer_entries > 0) {
+		const WriteBufferStatistics& buffer = stats.write_buffer;
+		printf("\n%-17s: %llu\n", "wb writes", buffer.writes);
+		printf("%-17s: %llu\n", "wb coalesced", buffer.coalesced);
+		printf("%-17s: ", "wb coalesce ratio");
+		if (buffer.writes > 0) {
+			printf("%f\n", static_cast<double>(buffer.coalesced) / buffer.writes);
+		} else {
+			printf("N/A\n");
+		}
+		printf("%-17s: %llu\n", "wb stalls", buffer.stalls);
+		printf("%-17s: %llu\n", "wb forwarded", buffer.forwarded);
+		printf("%-17s: %llu\n", "memory writes", buffer.memory_writes);
+	}
+
+	// the average memory access time of the cache references: the L1 hit
+	// latency plus the cycles spent below the L1 caches per reference
+	if (config.lower_levels > 0 || config.memory_latency > 0) {
+		printf("\n%-17s: ", "AMAT (cycles)");
+		if (stats.inst_refs > 0 || stats.data_refs > 0) {
+			printf("%f\n", config.l1_hit_latency + static_cast<double>(stats.miss_cycles) / (stats.inst_refs + stats.data_refs));
+		} else {
+			printf("N/A\n");
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include "config.h"
+
+using namespace std;
+
+// the prefetches of one cache: issued to memory, demanded before eviction
+// (useful), of those demanded before they arrived (late), and demand misses
+// on lines a prefetch had evicted (polluting)
+struct PrefetchStatistics
+{
+	unsigned long long issued;
+	unsigned long long useful;
+	unsigned long long late;
+	unsigned long long polluting;
+};
+
+// the accesses of one unified cache level below the L1 caches: line reads
+// for the level above (hits and misses), the victims, write-backs and
+// write-through stores it received (writes), and the reads and writes it
+// sent on to the next level or memory (traffic)
+struct LevelStatistics
+{
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long writes;
+	unsigned long long traffic;
+};
+
+// the writes that reached the write buffer, those merged into a line it
+// already held (coalesced), those that found it full and waited for its
+// oldest line to drain (stalls), the memory reads it served (forwarded) and
+// the line writes it sent to memory
+struct WriteBufferStatistics
+{
+	unsigned long long writes;
+	unsigned long long coalesced;
+	unsigned long long stalls;
+	unsigned long long forwarded;
+	unsigned long long memory_writes;
+};
+
+struct Statistics
+{
+	unsigned long long itlb_hits;
+	unsigned long long itlb_misses;
+	unsigned long long dtlb_hits;
+	unsigned long long dtlb_misses;
+	unsigned long long pt_hits;
+	unsigned long long pt_faults;
+	unsigned long long ic_hits;
+	unsigned long long ic_misses;
+	unsigned long long dc_hits;
+	unsigned long long dc_misses;
+	unsigned long long reads;
+	unsigned long long writes;
+	unsigned long long inst_refs;
+	unsigned long long data_refs;
+	unsigned long long memory_refs;
+	unsigned long long disk_refs;
+	PrefetchStatistics ic_prefetches;
+	PrefetchStatistics dc_prefetches;
+	LevelStatistics levels[MAX_LOWER_LEVELS];
+	unsigned long long miss_cycles; // spent below the L1 caches by demand references
+	WriteBufferStatistics write_buffer;
+};
+
+void printStatistics(const Config&, const Statistics&);
+
+#endif
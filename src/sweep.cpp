@@ -0,0 +1,279 @@
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "config.h"
+#include "error.h"
+#include "hierarchy.h"
+#include "statistics.h"
+#include "sweep.h"
+#include "trace.h"
+#include "translated.h"
+using namespace std;
+
+// configuration values a sweep file can override, by name
+struct SweepParameter
+{
+	const char *name;
+	void (*set)(Config&, long long);
+	long long max; // the largest value the field holds
+};
+
+template <typename T, T Config::*FIELD>
+void setSweepField(Config& config, long long value)
+{
+	config.*FIELD = value;
+}
+
+template <int LEVEL, int LevelConfig::*FIELD>
+void setSweepLevel(Config& config, long long value)
+{
+	static_assert(LEVEL >= 2 && LEVEL < 2 + MAX_LOWER_LEVELS, "no such lower level");
+	config.levels[LEVEL - 2].*FIELD = value;
+}
+
+const SweepParameter SWEEP_PARAMETERS[] = {
+	{"itlb_sets", setSweepField<int, &Config::instruction_tlb_sets>, INT_MAX},
+	{"itlb_assoc", setSweepField<int, &Config::instruction_tlb_set_size>, INT_MAX},
+	{"dtlb_sets", setSweepField<int, &Config::data_tlb_sets>, INT_MAX},
+	{"dtlb_assoc", setSweepField<int, &Config::data_tlb_set_size>, INT_MAX},
+	{"virtual_pages", setSweepField<uint64_t, &Config::virtual_pages>, LLONG_MAX},
+	{"physical_pages", setSweepField<int, &Config::physical_pages>, INT_MAX},
+	{"page_size", setSweepField<int, &Config::page_size>, INT_MAX},
+	{"ic_sets", setSweepField<int, &Config::instruction_cache_sets>, INT_MAX},
+	{"ic_assoc", setSweepField<int, &Config::instruction_cache_set_size>, INT_MAX},
+	{"ic_line", setSweepField<int, &Config::instruction_cache_line_size>, INT_MAX},
+	{"dc_sets", setSweepField<int, &Config::data_cache_sets>, INT_MAX},
+	{"dc_assoc", setSweepField<int, &Config::data_cache_set_size>, INT_MAX},
+	{"dc_line", setSweepField<int, &Config::data_cache_line_size>, INT_MAX},
+	{"ic_prefetch_degree", setSweepField<int, &Config::instruction_prefetch_degree>, INT_MAX},
+	{"dc_prefetch_degree", setSweepField<int, &Config::data_prefetch_degree>, INT_MAX},
+	{"prefetch_latency", setSweepField<int, &Config::prefetch_latency>, INT_MAX},
+	{"l2_sets", setSweepLevel<2, &LevelConfig::sets>, INT_MAX},
+	{"l2_assoc", setSweepLevel<2, &LevelConfig::set_size>, INT_MAX},
+	{"l2_line", setSweepLevel<2, &LevelConfig::line_size>, INT_MAX},
+	{"l3_sets", setSweepLevel<3, &LevelConfig::sets>, INT_MAX},
+	{"l3_assoc", setSweepLevel<3, &LevelConfig::set_size>, INT_MAX},
+	{"l3_line", setSweepLevel<3, &LevelConfig::line_size>, INT_MAX},
+	{"l4_sets", setSweepLevel<4, &LevelConfig::sets>, INT_MAX},
+	{"l4_assoc", setSweepLevel<4, &LevelConfig::set_size>, INT_MAX},
+	{"l4_line", setSweepLevel<4, &LevelConfig::line_size>, INT_MAX},
+	{"wb_entries", setSweepField<int, &Config::write_buffer_entries>, INT_MAX},
+	{"wb_age", setSweepField<int, &Config::write_buffer_age>, INT_MAX},
+};
+
+struct SweepPoint
+{
+	string description;
+	Config config;
+};
+
+vector<long long> parseSweepValues(const string& values, long long max, int line_num)
+{
+	// comma separated list of values or lo..hi ranges that double each step
+	vector<long long> result;
+	istringstream list(values);
+	string item;
+	while (getline(list, item, ',')) {
+		size_t dots = item.find("..");
+		char *end;
+		errno = 0;
+		long long lo = strtoll(item.c_str(), &end, 10);
+		long long hi = lo;
+		if (dots != string::npos) {
+			hi = strtoll(item.c_str() + dots + 2, &end, 10);
+		}
+		if (item.empty() || *end != '\0' || (dots != string::npos && end == item.c_str() + dots + 2) || lo < 1 || hi < lo) {
+			throwError("invalid sweep value %s on line %d", item.c_str(), line_num);
+		}
+		if (errno == ERANGE || hi > max) {
+			throwError("sweep value %s on line %d is out of range", item.c_str(), line_num);
+		}
+		for (long long v = lo;; v *= 2) {
+			result.push_back(v);
+			if (v > hi / 2) {
+				break; // the next doubling would pass hi, or overflow
+			}
+		}
+	}
+	return result;
+}
+
+void expandSweepLine(Config config, string description, const vector<pair<const SweepParameter*, vector<long long> > >& overrides, size_t next, vector<SweepPoint>& points)
+{
+	if (next == overrides.size()) {
+		SweepPoint point;
+		point.description = description;
+		point.config = finishConfig(config);
+		points.push_back(point);
+		return;
+	}
+	const vector<long long>& values = overrides[next].second;
+	for (size_t i = 0; i < values.size(); ++i) {
+		overrides[next].first->set(config, values[i]);
+		expandSweepLine(config, description + " " + overrides[next].first->name + "=" + to_string(values[i]), overrides, next + 1, points);
+	}
+}
+
+vector<SweepPoint> parseSweepFile(string sweep_filename)
+{
+	ifstream in_file(sweep_filename.c_str());
+	string file_str;
+	int line_num = 0;
+	vector<SweepPoint> points;
+
+	if (!in_file.is_open()) {
+		throwError("failed to open sweep file %s", sweep_filename.c_str());
+	}
+	while (getline(in_file, file_str)) {
+		++line_num;
+		istringstream line(file_str.substr(0, file_str.find('#')));
+		string config_filename;
+		string token;
+		vector<pair<const SweepParameter*, vector<long long> > > overrides;
+
+		if (!(line >> config_filename)) {
+			continue; // blank or comment line
+		}
+		while (line >> token) {
+			size_t equals = token.find('=');
+			const SweepParameter *parameter = nullptr;
+			for (const SweepParameter& p : SWEEP_PARAMETERS) {
+				if (token.compare(0, equals, p.name) == 0 && strlen(p.name) == equals) {
+					parameter = &p;
+				}
+			}
+			if (equals == string::npos || parameter == nullptr) {
+				throwError("unknown sweep parameter %s on line %d", token.c_str(), line_num);
+			}
+			overrides.push_back(make_pair(parameter, parseSweepValues(token.substr(equals + 1), parameter->max, line_num)));
+		}
+		expandSweepLine(getConfig(config_filename), config_filename, overrides, 0, points);
+	}
+	if (points.empty()) {
+		throwError("sweep file %s lists no configurations", sweep_filename.c_str());
+	}
+	return points;
+}
+
+// records replayed by every configuration of a parallel sweep worker before
+// it moves on, small enough for the slice to stay in the worker's L2 cache
+const size_t SWEEP_CHUNK = 8192;
+
+// the sweep loops below serve both trace records and translated records
+void simulateRecords(Hierarchy *hierarchy, const TraceRecord *records, size_t count)
+{
+	hierarchy->simulate(records, count, nullptr);
+}
+
+void simulateRecords(Hierarchy *hierarchy, const TranslatedRecord *records, size_t count)
+{
+	hierarchy->replay(records, count);
+}
+
+template <typename Record>
+void runParallelSweep(const vector<Record>& records, const vector<Hierarchy*>& hierarchies, int threads)
+{
+	// workers claim small groups of configurations and replay the shared,
+	// read-only trace through the whole group chunk by chunk; each Hierarchy
+	// is touched by exactly one worker, so the statistics are the same as
+	// those of a sequential sweep. The first error a worker hits stops the
+	// others from claiming more groups and is rethrown here
+	size_t group = max<size_t>(1, hierarchies.size() / (threads * 4));
+	atomic<size_t> next_group(0);
+	vector<thread> workers;
+	exception_ptr error;
+	mutex error_lock;
+
+	for (int t = 0; t < threads; ++t) {
+		workers.push_back(thread([&]() {
+			size_t first;
+			try {
+				while ((first = next_group.fetch_add(group)) < hierarchies.size()) {
+					size_t last = min(first + group, hierarchies.size());
+					for (size_t r = 0; r < records.size(); r += SWEEP_CHUNK) {
+						size_t count = min(SWEEP_CHUNK, records.size() - r);
+						for (size_t i = first; i < last; ++i) {
+							simulateRecords(hierarchies[i], &records[r], count);
+						}
+					}
+				}
+			} catch (...) {
+				lock_guard<mutex> guard(error_lock);
+				if (error == nullptr) {
+					error = current_exception();
+				}
+				next_group.store(hierarchies.size());
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); ++t) {
+		workers[t].join();
+	}
+	if (error != nullptr) {
+		rethrow_exception(error);
+	}
+}
+
+template <typename Record, typename Reader>
+void sweepTrace(Reader *trace, const vector<Hierarchy*>& hierarchies, int threads)
+{
+	const Record *batch;
+	size_t count;
+
+	if (threads > 1) {
+		// decode the whole trace up front so the workers can share it
+		vector<Record> records;
+		while ((count = trace->nextBatch(batch)) > 0) {
+			records.insert(records.end(), batch, batch + count);
+		}
+		runParallelSweep(records, hierarchies, threads);
+	} else {
+		// every configuration replays each decoded batch while it is still in
+		// cache, so the trace is read and parsed only once for the whole sweep
+		while ((count = trace->nextBatch(batch)) > 0) {
+			for (size_t i = 0; i < hierarchies.size(); ++i) {
+				simulateRecords(hierarchies[i], batch, count);
+			}
+		}
+	}
+}
+
+void runSweep(TraceReader *trace, TranslatedTraceReader *replay_trace, string sweep_filename, int threads, int sample_rate)
+{
+	// replay_trace, when given, stands in for the trace; then the sweep may
+	// only vary the caches
+	vector<SweepPoint> points = parseSweepFile(sweep_filename);
+	vector<Hierarchy*> hierarchies;
+
+	for (size_t i = 0; i < points.size(); ++i) {
+		if (replay_trace != nullptr) {
+			replay_trace->checkConfig(points[i].config);
+		}
+		hierarchies.push_back(new Hierarchy(points[i].config, sample_rate));
+	}
+	threads = min<size_t>(threads, points.size());
+	if (replay_trace != nullptr) {
+		sweepTrace<TranslatedRecord>(replay_trace, hierarchies, threads);
+	} else {
+		sweepTrace<TraceRecord>(trace, hierarchies, threads);
+	}
+	for (size_t i = 0; i < points.size(); ++i) {
+		printf("%sConfiguration %lu of %lu: %s\n\n", (i > 0) ? "\n\n" : "", i + 1, points.size(), points[i].description.c_str());
+		printConfig(points[i].config);
+		printf("\n");
+		printStatistics(points[i].config, hierarchies[i]->statistics());
+		hierarchies[i]->printSampling();
+		delete hierarchies[i];
+	}
+}
@@ -0,0 +1,12 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <string>
+#include "trace.h"
+#include "translated.h"
+
+using namespace std;
+
+void runSweep(TraceReader*, TranslatedTraceReader*, string, int, int);
+
+#endif
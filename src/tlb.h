@@ -0,0 +1,158 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include "cache.h"
+#include "checkpoint.h"
+#include "frames.h"
+#include "replacement.h"
+
+using namespace std;
+
+class TLBSet
+{
+public:
+	// view of one set inside the contiguous storage owned by TLB; ways are
+	// addressed by index and the replacement state is one byte per way.
+	// WAYS is the associativity when known at compile time, 0 otherwise,
+	// and POLICY the replacement policy class (see replacement.h)
+	TLBSet(int n, uint64_t *k, unsigned int *p, unsigned char *r, ReplacementContext *c)
+	{
+		num_entries = n;
+		keys = k;
+		phys_page_nums = p;
+		replacement = r;
+		context = c;
+	}
+	template <int WAYS, class POLICY>
+	unsigned int readEntry(uint64_t tag)
+	{
+		unsigned int matches = matchKeys<WAYS>(keys, ways<WAYS>(), makeKey(tag, true));
+		if (matches != 0) {
+			int way = __builtin_ctz(matches);
+			POLICY::hit(replacement, ways<WAYS>(), way);
+			return phys_page_nums[way];
+		}
+		return UINT_MAX;
+	}
+	template <int WAYS, class POLICY>
+	int addEntry(uint64_t tag, unsigned int phys_page_num)
+	{
+		int way = POLICY::victim(replacement, ways<WAYS>(), *context);
+		phys_page_nums[way] = phys_page_num;
+		keys[way] = makeKey(tag, true);
+		POLICY::fill(replacement, ways<WAYS>(), way, *context);
+		return way; // way that was replaced
+	}
+private:
+	template <int WAYS>
+	int ways()
+	{
+		return (WAYS != 0) ? WAYS : num_entries;
+	}
+
+	int num_entries;
+	uint64_t *keys;
+	unsigned int *phys_page_nums;
+	unsigned char *replacement;
+	ReplacementContext *context;
+};
+
+class TLB
+{
+public:
+	TLB(int s, int ss, int num_frames, string t, ReplacementPolicy p, const ReplacementContext& c) : context(c)
+	{
+		num_sets = s;
+		set_size = ss;
+		type = t;
+		policy = p;
+		num_ways = num_sets * set_size;
+		// all ways of all sets live in one block, laid out field by field:
+		// tag/valid keys, physical page numbers, replacement state
+		block = new unsigned char[num_ways * BYTES_PER_WAY];
+		keys = reinterpret_cast<uint64_t*>(block);
+		phys_page_nums = reinterpret_cast<unsigned int*>(keys + num_ways);
+		replacement = reinterpret_cast<unsigned char*>(phys_page_nums + num_ways);
+		for (int i = 0; i < num_ways; ++i) {
+			keys[i] = makeKey(KEY_TAG, false);
+			phys_page_nums[i] = UINT_MAX;
+		}
+		for (int i = 0; i < num_sets; ++i) {
+			REPLACEMENT_DISPATCH(policy, POLICY::reset(replacement + i * set_size, set_size));
+		}
+		frame_entries = new FrameIndex(num_frames, num_ways);
+	}
+	~TLB()
+	{
+		delete frame_entries;
+		delete[] block;
+	}
+	template <int WAYS = 0>
+	unsigned int readEntry(unsigned int index, uint64_t tag)
+	{
+		TLBSet s = set<WAYS>(index);
+		REPLACEMENT_DISPATCH(policy, return s.template readEntry<WAYS, POLICY>(tag));
+	}
+	template <int WAYS = 0>
+	void addEntry(unsigned int index, uint64_t tag, unsigned int phys_page_num)
+	{
+		TLBSet s = set<WAYS>(index);
+		unsigned int entry = firstWay<WAYS>(index);
+		REPLACEMENT_DISPATCH(policy, entry += s.template addEntry<WAYS, POLICY>(tag, phys_page_num));
+		frame_entries->link(entry, phys_page_num);
+	}
+	void invalidateEntries(unsigned int phys_page_num)
+	{
+		// invalid entries can never match again, so they leave the chain
+		unsigned int entry = frame_entries->first(phys_page_num);
+		while (entry != UINT_MAX) {
+			unsigned int next = frame_entries->next(entry);
+			keys[entry] &= ~KEY_VALID;
+			frame_entries->unlink(entry);
+			entry = next;
+		}
+	}
+	void save(CheckpointWriter& out)
+	{
+		out.write(block, num_ways * BYTES_PER_WAY);
+		context.save(out);
+		frame_entries->save(out);
+	}
+	void restore(CheckpointReader& in)
+	{
+		in.read(block, num_ways * BYTES_PER_WAY);
+		context.restore(in);
+		frame_entries->restore(in);
+	}
+private:
+	static const size_t BYTES_PER_WAY = sizeof(uint64_t) + sizeof(unsigned int) + 1;
+
+	template <int WAYS>
+	unsigned int firstWay(unsigned int index)
+	{
+		return index * ((WAYS != 0) ? WAYS : set_size);
+	}
+	template <int WAYS>
+	TLBSet set(unsigned int index)
+	{
+		unsigned int first = firstWay<WAYS>(index);
+		return TLBSet(set_size, keys + first, phys_page_nums + first, replacement + first, &context);
+	}
+
+	int num_sets;
+	int set_size;
+	int num_ways;
+	string type;
+	ReplacementPolicy policy;
+	ReplacementContext context;
+	unsigned char *block;
+	uint64_t *keys;
+	unsigned int *phys_page_nums;
+	unsigned char *replacement;
+	FrameIndex *frame_entries;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "error.h"
+#include "trace.h"
+using namespace std;
+
+static const size_t BATCH_RECORDS = 1 << 16;
+
+// closes out and throws on a short write
+static void writeRecords(const void *data, size_t size, size_t n, FILE *out, const string& filename)
+{
+	if (fwrite(data, size, n, out) < n) {
+		fclose(out);
+		throwError("failed to write %s", filename.c_str());
+	}
+}
+
+void writeBinaryTrace(TraceReader *trace, string filename, uint64_t line_size)
+{
+	// line_size 0 copies every record, a power of two coalesces runs (see -k)
+	FILE *out = fopen(filename.c_str(), "wb");
+	if (out == nullptr) {
+		throwError("failed to open %s for writing", filename.c_str());
+	}
+	TraceFileHeader header;
+	memcpy(header.magic, "HTRC", 4);
+	header.version = TRACE_FILE_VERSION;
+	writeRecords(&header, sizeof(header), 1, out, filename);
+
+	const TraceRecord *batch;
+	size_t n;
+	if (line_size == 0) {
+		while ((n = trace->nextBatch(batch)) > 0) {
+			writeRecords(batch, sizeof(TraceRecord), n, out, filename);
+		}
+	} else {
+		// fold each run of consecutive references of one stream and access
+		// type to the same line_size-byte line into its first record
+		vector<TraceRecord> records;
+		while ((n = trace->nextBatch(batch)) > 0) {
+			for (size_t r = 0; r < n; ++r) {
+				const TraceRecord& record = batch[r];
+				if (!records.empty()) {
+					TraceRecord& last = records.back();
+					if (record.stream_type == last.stream_type && record.access_type == last.access_type && record.address_digits == last.address_digits
+							&& (record.address ^ last.address) < line_size && last.repeats < UINT32_MAX - record.repeats) {
+						last.repeats += 1 + record.repeats;
+						continue;
+					}
+				}
+				if (records.size() == BATCH_RECORDS) {
+					// the last record stays, its run may continue
+					writeRecords(records.data(), sizeof(TraceRecord), records.size() - 1, out, filename);
+					records.erase(records.begin(), records.end() - 1);
+				}
+				records.push_back(record);
+			}
+		}
+		writeRecords(records.data(), sizeof(TraceRecord), records.size(), out, filename);
+	}
+	bool failed = ferror(out) != 0;
+	if ((fclose(out) != 0) || failed) {
+		throwError("failed to write %s", filename.c_str());
+	}
+}
@@ -0,0 +1,629 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "error.h"
+
+using namespace std;
+
+// one decoded trace reference; this is also the on-disk record of a binary
+// trace, so its layout must not change without bumping the file version
+struct TraceRecord
+{
+	uint64_t address;
+	char stream_type; // 'I' or 'D'
+	char access_type; // 'R' or 'W'
+	uint8_t address_digits; // number of hex digits the address was written with
+	uint8_t reserved;
+	uint32_t repeats; // references to the same line that follow, folded into this one
+};
+
+inline uint8_t hexDigits(uint64_t address)
+{
+	// number of hex digits the address is written with, without leading
+	// zeros; in-process references pass it as their address_digits
+	return (address == 0) ? 1 : (67 - __builtin_clzll(address)) / 4;
+}
+
+struct TraceFileHeader
+{
+	char magic[4]; // "HTRC"
+	uint32_t version;
+};
+
+const uint32_t TRACE_FILE_VERSION = 3;
+
+class TraceReader
+{
+public:
+	TraceReader()
+	{
+		records = nullptr;
+		count = 0;
+		position = 0;
+	}
+	virtual ~TraceReader()
+	{
+	}
+	size_t nextBatch(const TraceRecord *&batch)
+	{
+		// hand out whatever is left of the current batch before refilling
+		if (position == count) {
+			count = fill(records);
+			position = 0;
+		}
+		batch = records + position;
+		size_t n = count - position;
+		position = count;
+		return n;
+	}
+	unsigned long long skip(unsigned long long n)
+	{
+		// drops the next n records, returns how many the trace still had
+		unsigned long long skipped = 0;
+		while (skipped < n) {
+			if (position == count) {
+				count = fill(records);
+				position = 0;
+				if (count == 0) {
+					break;
+				}
+			}
+			size_t step = min<unsigned long long>(count - position, n - skipped);
+			position += step;
+			skipped += step;
+		}
+		return skipped;
+	}
+protected:
+	virtual size_t fill(const TraceRecord *&batch) = 0;
+private:
+	const TraceRecord *records;
+	size_t count;
+	size_t position;
+};
+
+enum ParseResult
+{
+	PARSE_RECORD,
+	PARSE_BLANK,
+	PARSE_MALFORMED,
+	PARSE_TOO_LARGE
+};
+
+class TraceLineParser
+{
+public:
+	// parses one text trace line, <stream type><sep><access type><sep><hex
+	// address>, e.g. "D:W:1a2c"; shared by the text reader and the decoder
+	// threads of the pipelined reader, which report errors out of line
+	static ParseResult parseLine(const char *p, const char *line_end, TraceRecord& record)
+	{
+		p = skipSpace(p, line_end);
+		if (p == line_end) {
+			return PARSE_BLANK;
+		}
+		record.stream_type = *p++;
+		if (p != line_end) {
+			++p;
+		}
+		p = skipSpace(p, line_end);
+		if (p == line_end) {
+			return PARSE_MALFORMED;
+		}
+		record.access_type = *p++;
+		if (p != line_end) {
+			++p;
+		}
+		p = skipSpace(p, line_end);
+		const char *token = p;
+		if ((line_end - p > 2) && (p[0] == '0') && (p[1] == 'x' || p[1] == 'X')) {
+			p += 2;
+		}
+		uint64_t address = 0;
+		const char *digits = p;
+		for (; p != line_end && !isSpace(*p); ++p) {
+			int value = hexValue(*p);
+			if (value < 0) {
+				return PARSE_MALFORMED;
+			}
+			if ((address >> 60) != 0) {
+				return PARSE_TOO_LARGE;
+			}
+			address = (address << 4) | value;
+		}
+		if (p == digits) {
+			return PARSE_MALFORMED;
+		}
+		record.address = address;
+		record.address_digits = p - token;
+		record.reserved = 0;
+		record.repeats = 0;
+		return PARSE_RECORD;
+	}
+	[[noreturn]] static void fail(ParseResult result, unsigned long line_num)
+	{
+		if (result == PARSE_TOO_LARGE) {
+			throwError("address on trace line %lu is too large", line_num);
+		}
+		throwError("malformed trace line %lu", line_num);
+	}
+private:
+	static bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+	static const char *skipSpace(const char *p, const char *line_end)
+	{
+		while (p != line_end && isSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+	static int hexValue(char c)
+	{
+		if (c >= '0' && c <= '9') {
+			return c - '0';
+		}
+		if (c >= 'a' && c <= 'f') {
+			return c - 'a' + 10;
+		}
+		if (c >= 'A' && c <= 'F') {
+			return c - 'A' + 10;
+		}
+		return -1;
+	}
+};
+
+class TextTraceReader : public TraceReader
+{
+public:
+	TextTraceReader(int f)
+	{
+		fd = f;
+		buffer = new char[BUFFER_SIZE];
+		batch_records = new TraceRecord[BATCH_SIZE];
+		begin = buffer;
+		end = buffer;
+		eof = false;
+		line_num = 0;
+	}
+	~TextTraceReader()
+	{
+		delete[] buffer;
+		delete[] batch_records;
+	}
+protected:
+	size_t fill(const TraceRecord *&batch)
+	{
+		size_t n = 0;
+		while (n < BATCH_SIZE) {
+			char *newline = static_cast<char*>(memchr(begin, '\n', end - begin));
+			if (newline == nullptr) {
+				if (!eof) {
+					refill();
+					continue;
+				}
+				if (begin == end) {
+					break;
+				}
+				newline = end; // last line has no terminating newline
+			}
+			++line_num;
+			ParseResult result = TraceLineParser::parseLine(begin, newline, batch_records[n]);
+			if (result == PARSE_RECORD) {
+				++n;
+			} else if (result != PARSE_BLANK) {
+				TraceLineParser::fail(result, line_num);
+			}
+			begin = (newline == end) ? end : newline + 1;
+		}
+		batch = batch_records;
+		return n;
+	}
+private:
+	static const size_t BUFFER_SIZE = 1 << 20;
+	static const size_t BATCH_SIZE = 4096;
+
+	void refill()
+	{
+		// keep the partial line at the front of the buffer and read behind it
+		size_t pending = end - begin;
+		if (pending == BUFFER_SIZE) {
+			throwError("trace line %lu is too long", line_num + 1);
+		}
+		memmove(buffer, begin, pending);
+		begin = buffer;
+		end = buffer + pending;
+		ssize_t bytes = read(fd, end, BUFFER_SIZE - pending);
+		if (bytes < 0) {
+			throwError("failed to read trace: %s", strerror(errno));
+		}
+		if (bytes == 0) {
+			eof = true;
+		}
+		end += bytes;
+	}
+
+	int fd;
+	char *buffer;
+	char *begin;
+	char *end;
+	bool eof;
+	unsigned long line_num;
+	TraceRecord *batch_records;
+};
+
+template<typename T>
+class SpscRing
+{
+public:
+	// bounded lock-free queue between exactly one producer and one consumer
+	SpscRing(size_t capacity)
+	{
+		slots = new T[capacity];
+		mask = capacity - 1;
+		head.store(0, memory_order_relaxed);
+		tail.store(0, memory_order_relaxed);
+	}
+	~SpscRing()
+	{
+		delete[] slots;
+	}
+	bool tryPush(const T& value)
+	{
+		size_t t = tail.load(memory_order_relaxed);
+		if (t - head.load(memory_order_acquire) > mask) {
+			return false;
+		}
+		slots[t & mask] = value;
+		tail.store(t + 1, memory_order_release);
+		return true;
+	}
+	bool tryPop(T& value)
+	{
+		size_t h = head.load(memory_order_relaxed);
+		if (h == tail.load(memory_order_acquire)) {
+			return false;
+		}
+		value = slots[h & mask];
+		head.store(h + 1, memory_order_release);
+		return true;
+	}
+private:
+	// the indices live on their own cache lines so the two sides do not
+	// invalidate each other on every operation
+	alignas(64) atomic<size_t> head;
+	alignas(64) atomic<size_t> tail;
+	alignas(64) T *slots;
+	size_t mask;
+};
+
+struct TraceBlock
+{
+	char *text;
+	size_t text_size;
+	bool too_long;
+	int read_error; // errno of a failed read of the trace, or 0
+	TraceRecord *records;
+	size_t count;
+	unsigned long lines;
+	ParseResult error;
+	unsigned long error_line;
+};
+
+class PipelinedTraceReader : public TraceReader
+{
+public:
+	// a reader thread cuts the trace into blocks of whole lines, decoder
+	// threads parse them and the simulation pops the parsed blocks in the
+	// order they were read; a nullptr block marks the end of the trace
+	PipelinedTraceReader(int f, int decoder_count)
+	{
+		fd = f;
+		decoders = decoder_count;
+		stopping.store(false);
+		for (int i = 0; i < decoders; ++i) {
+			text_rings.push_back(new SpscRing<TraceBlock*>(RING_SIZE));
+			parsed_rings.push_back(new SpscRing<TraceBlock*>(RING_SIZE));
+		}
+		current = nullptr;
+		next_ring = 0;
+		done = false;
+		line_num = 0;
+		threads.push_back(thread(&PipelinedTraceReader::readBlocks, this));
+		for (int i = 0; i < decoders; ++i) {
+			threads.push_back(thread(&PipelinedTraceReader::decodeBlocks, this, i));
+		}
+	}
+	~PipelinedTraceReader()
+	{
+		stopping.store(true);
+		for (size_t i = 0; i < threads.size(); ++i) {
+			threads[i].join();
+		}
+		TraceBlock *block;
+		for (int i = 0; i < decoders; ++i) {
+			while (text_rings[i]->tryPop(block)) {
+				deleteBlock(block);
+			}
+			while (parsed_rings[i]->tryPop(block)) {
+				deleteBlock(block);
+			}
+			delete text_rings[i];
+			delete parsed_rings[i];
+		}
+		deleteBlock(current);
+	}
+protected:
+	size_t fill(const TraceRecord *&batch)
+	{
+		while (!done) {
+			deleteBlock(current);
+			current = nullptr;
+			pop(parsed_rings[next_ring], current);
+			next_ring = (next_ring + 1) % decoders;
+			if (current == nullptr) {
+				done = true;
+				break;
+			}
+			if (current->read_error != 0) {
+				throwError("failed to read trace: %s", strerror(current->read_error));
+			}
+			if (current->too_long) {
+				throwError("trace line %lu is too long", line_num + 1);
+			}
+			if (current->error != PARSE_RECORD) {
+				TraceLineParser::fail(current->error, line_num + current->error_line);
+			}
+			line_num += current->lines;
+			if (current->count > 0) {
+				batch = current->records;
+				return current->count;
+			}
+		}
+		return 0;
+	}
+private:
+	static const size_t BLOCK_SIZE = 1 << 18;
+	static const size_t MAX_LINE = 1 << 20;
+	static const size_t RING_SIZE = 4;
+
+	void readBlocks()
+	{
+		char *carry = nullptr;
+		size_t carry_size = 0;
+		int ring = 0;
+		bool eof = false;
+		int read_error = 0;
+		while (!eof) {
+			char *text = new char[carry_size + BLOCK_SIZE];
+			memcpy(text, carry, carry_size);
+			delete[] carry;
+			carry = nullptr;
+			size_t size = carry_size;
+			while (size < carry_size + BLOCK_SIZE) {
+				ssize_t bytes = read(fd, text + size, carry_size + BLOCK_SIZE - size);
+				if (bytes < 0) {
+					read_error = errno;
+					eof = true;
+					break;
+				}
+				if (bytes == 0) {
+					eof = true;
+					break;
+				}
+				size += bytes;
+			}
+			// hold back the partial last line for the next block, or drop it
+			// when the read that would have finished it failed
+			size_t cut = size;
+			if (!eof || read_error != 0) {
+				char *newline = static_cast<char*>(memrchr(text, '\n', size));
+				cut = (newline == nullptr) ? 0 : newline + 1 - text;
+			}
+			carry_size = size - cut;
+			if (carry_size > 0) {
+				carry = new char[carry_size];
+				memcpy(carry, text + cut, carry_size);
+			}
+			TraceBlock *block = nullptr;
+			if (cut > 0) {
+				block = newBlock(text, cut);
+			} else {
+				delete[] text;
+			}
+			if (carry_size >= MAX_LINE || read_error != 0) {
+				if (block != nullptr) {
+					if (!push(text_rings[ring], block)) {
+						break;
+					}
+					ring = (ring + 1) % decoders;
+				}
+				// the simulation raises the error once it reaches this block
+				block = newBlock(nullptr, 0);
+				block->too_long = (read_error == 0);
+				block->read_error = read_error;
+				eof = true;
+			}
+			if (block != nullptr) {
+				if (!push(text_rings[ring], block)) {
+					break;
+				}
+				ring = (ring + 1) % decoders;
+			}
+		}
+		delete[] carry;
+		for (int i = 0; i < decoders; ++i) {
+			push(text_rings[i], nullptr);
+		}
+	}
+	void decodeBlocks(int ring)
+	{
+		TraceBlock *block;
+		do {
+			if (!pop(text_rings[ring], block)) {
+				return;
+			}
+			if (block != nullptr && !block->too_long && block->read_error == 0) {
+				decodeBlock(block);
+			}
+		} while (push(parsed_rings[ring], block) && block != nullptr);
+	}
+	void decodeBlock(TraceBlock *block)
+	{
+		const char *begin = block->text;
+		const char *end = block->text + block->text_size;
+		size_t max_records = 1;
+		for (const char *p = begin; (p = static_cast<const char*>(memchr(p, '\n', end - p))) != nullptr; ++p) {
+			++max_records;
+		}
+		block->records = new TraceRecord[max_records];
+		while (begin != end) {
+			const char *newline = static_cast<const char*>(memchr(begin, '\n', end - begin));
+			if (newline == nullptr) {
+				newline = end; // last line of the trace has no terminating newline
+			}
+			++block->lines;
+			ParseResult result = TraceLineParser::parseLine(begin, newline, block->records[block->count]);
+			if (result == PARSE_RECORD) {
+				++block->count;
+			} else if (result != PARSE_BLANK) {
+				block->error = result;
+				block->error_line = block->lines;
+				break;
+			}
+			begin = (newline == end) ? end : newline + 1;
+		}
+		delete[] block->text;
+		block->text = nullptr;
+	}
+	bool push(SpscRing<TraceBlock*> *ring, TraceBlock *block)
+	{
+		while (!ring->tryPush(block)) {
+			if (stopping.load(memory_order_relaxed)) {
+				deleteBlock(block);
+				return false;
+			}
+			this_thread::yield();
+		}
+		return true;
+	}
+	bool pop(SpscRing<TraceBlock*> *ring, TraceBlock *&block)
+	{
+		while (!ring->tryPop(block)) {
+			if (stopping.load(memory_order_relaxed)) {
+				block = nullptr;
+				return false;
+			}
+			this_thread::yield();
+		}
+		return true;
+	}
+	static TraceBlock *newBlock(char *text, size_t size)
+	{
+		TraceBlock *block = new TraceBlock;
+		block->text = text;
+		block->text_size = size;
+		block->too_long = false;
+		block->read_error = 0;
+		block->records = nullptr;
+		block->count = 0;
+		block->lines = 0;
+		block->error = PARSE_RECORD;
+		block->error_line = 0;
+		return block;
+	}
+	static void deleteBlock(TraceBlock *block)
+	{
+		if (block != nullptr) {
+			delete[] block->text;
+			delete[] block->records;
+			delete block;
+		}
+	}
+
+	int fd;
+	int decoders;
+	atomic<bool> stopping;
+	vector<SpscRing<TraceBlock*>*> text_rings;
+	vector<SpscRing<TraceBlock*>*> parsed_rings;
+	vector<thread> threads;
+	TraceBlock *current;
+	int next_ring;
+	bool done;
+	unsigned long line_num;
+};
+
+class BinaryTraceReader : public TraceReader
+{
+public:
+	BinaryTraceReader(string filename)
+	{
+		struct stat st;
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0 || fstat(fd, &st) < 0) {
+			if (fd >= 0) {
+				close(fd);
+			}
+			throwError("failed to open binary trace %s", filename.c_str());
+		}
+		size = st.st_size;
+		if (size < sizeof(TraceFileHeader) || (size - sizeof(TraceFileHeader)) % sizeof(TraceRecord) != 0) {
+			close(fd);
+			throwError("%s is not a binary trace", filename.c_str());
+		}
+		map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) {
+			throwError("failed to map binary trace %s", filename.c_str());
+		}
+		madvise(map, size, MADV_SEQUENTIAL);
+		const TraceFileHeader *header = static_cast<const TraceFileHeader*>(map);
+		if (memcmp(header->magic, "HTRC", 4) != 0 || header->version != TRACE_FILE_VERSION) {
+			munmap(map, size);
+			throwError("%s is not a version %u binary trace", filename.c_str(), TRACE_FILE_VERSION);
+		}
+		remaining = (size - sizeof(TraceFileHeader)) / sizeof(TraceRecord);
+		next_record = reinterpret_cast<const TraceRecord*>(static_cast<const char*>(map) + sizeof(TraceFileHeader));
+	}
+	~BinaryTraceReader()
+	{
+		munmap(map, size);
+	}
+protected:
+	size_t fill(const TraceRecord *&batch)
+	{
+		// the records are used in place; batches stay small enough to remain
+		// cache resident while several hierarchies replay them
+		batch = next_record;
+		size_t n = min(remaining, BATCH_SIZE);
+		next_record += n;
+		remaining -= n;
+		return n;
+	}
+private:
+	static const size_t BATCH_SIZE = 1 << 16;
+
+	void *map;
+	const TraceRecord *next_record;
+	size_t size;
+	size_t remaining;
+};
+
+void writeBinaryTrace(TraceReader*, string, uint64_t = 0);
+
+#endif
@@ -0,0 +1,25 @@
+#include <cstring>
+#include "translated.h"
+using namespace std;
+
+void translationGeometry(const Config& config, uint64_t *geometry)
+{
+	// the configuration values the TLB and page table results, and the frame
+	// every page lands in, depend on, in file order
+	uint64_t values[TRANSLATED_GEOMETRY_SIZE] = {
+		static_cast<uint64_t>(config.instruction_tlb_sets),
+		static_cast<uint64_t>(config.instruction_tlb_set_size),
+		static_cast<uint64_t>(config.data_tlb_sets),
+		static_cast<uint64_t>(config.data_tlb_set_size),
+		config.virtual_pages,
+		static_cast<uint64_t>(config.physical_pages),
+		static_cast<uint64_t>(config.page_size),
+		config.virtual_addresses_enabled,
+		config.tlbs_enabled,
+		config.instruction_tlb_policy,
+		config.data_tlb_policy,
+		config.frame_policy,
+		config.replacement_seed,
+	};
+	memcpy(geometry, values, sizeof(values));
+}
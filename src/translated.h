@@ -0,0 +1,200 @@
+#ifndef TRANSLATED_H
+#define TRANSLATED_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "config.h"
+#include "error.h"
+#include "report.h"
+#include "trace.h"
+
+using namespace std;
+
+// one reference after address translation, as the caches see it, or a page
+// eviction; the record of a translated trace (see -T and -x)
+struct TranslatedRecord
+{
+	uint64_t address; // physical address, with the bits the translation kept
+	uint32_t physical_page_num; // its frame, or the frame a page was evicted from
+	char stream_type; // 'I' or 'D', or 'E' for a page eviction
+	char access_type; // 'R' or 'W'; 'W' for an eviction that wrote the page back to disk
+	uint8_t address_digits;
+	uint8_t results; // TLB result in bits 0-1, page table result in bits 2-3
+};
+
+// number of configuration values a translated trace depends on, see
+// translationGeometry
+const int TRANSLATED_GEOMETRY_SIZE = 13;
+
+struct TranslatedFileHeader
+{
+	char magic[4]; // "HPTR"
+	uint32_t version;
+	uint64_t geometry[TRANSLATED_GEOMETRY_SIZE]; // TLB and page configuration it was recorded with
+};
+
+const uint32_t TRANSLATED_FILE_VERSION = 2;
+
+void translationGeometry(const Config&, uint64_t*);
+
+class TranslatedTraceWriter
+{
+public:
+	TranslatedTraceWriter(const Config& config, string filename)
+	{
+		out = fopen(filename.c_str(), "wb");
+		if (out == nullptr) {
+			throwError("failed to open %s for writing", filename.c_str());
+		}
+		TranslatedFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "HPTR", 4);
+		header.version = TRANSLATED_FILE_VERSION;
+		translationGeometry(config, header.geometry);
+		if (fwrite(&header, sizeof(header), 1, out) < 1) {
+			fclose(out);
+			throwError("failed to write translated trace");
+		}
+		records = new TranslatedRecord[BATCH_SIZE];
+		count = 0;
+	}
+	~TranslatedTraceWriter()
+	{
+		if (out != nullptr) {
+			// not closed, so a failure here goes unreported
+			fwrite(records, sizeof(TranslatedRecord), count, out);
+			fclose(out);
+		}
+		delete[] records;
+	}
+	void close()
+	{
+		// a destructor cannot report a failed write, so the owner closes
+		flush();
+		bool failed = ferror(out) != 0;
+		failed = (fclose(out) != 0) || failed;
+		out = nullptr;
+		if (failed) {
+			throwError("failed to write translated trace");
+		}
+	}
+	void writeReference(const TraceRecord& reference, uint64_t address, unsigned int phys_page_num, AccessResult tlb_result, AccessResult pt_result)
+	{
+		TranslatedRecord& record = next();
+		record.address = address;
+		record.physical_page_num = phys_page_num;
+		record.stream_type = reference.stream_type;
+		record.access_type = reference.access_type;
+		record.address_digits = reference.address_digits;
+		record.results = tlb_result | (pt_result << 2);
+	}
+	void writeEviction(unsigned int phys_page_num, bool written_back)
+	{
+		TranslatedRecord& record = next();
+		record.address = 0;
+		record.physical_page_num = phys_page_num;
+		record.stream_type = 'E';
+		record.access_type = written_back ? 'W' : 'R';
+		record.address_digits = 0;
+		record.results = 0;
+	}
+private:
+	static const size_t BATCH_SIZE = 16384;
+
+	TranslatedRecord& next()
+	{
+		if (count == BATCH_SIZE) {
+			flush();
+		}
+		return records[count++];
+	}
+	void flush()
+	{
+		bool failed = fwrite(records, sizeof(TranslatedRecord), count, out) < count;
+		count = 0;
+		if (failed) {
+			throwError("failed to write translated trace");
+		}
+	}
+
+	FILE *out;
+	TranslatedRecord *records;
+	size_t count;
+};
+
+class TranslatedTraceReader
+{
+public:
+	TranslatedTraceReader(string f)
+	{
+		struct stat st;
+		filename = f;
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0 || fstat(fd, &st) < 0) {
+			if (fd >= 0) {
+				close(fd);
+			}
+			throwError("failed to open translated trace %s", filename.c_str());
+		}
+		size = st.st_size;
+		if (size < sizeof(TranslatedFileHeader) || (size - sizeof(TranslatedFileHeader)) % sizeof(TranslatedRecord) != 0) {
+			close(fd);
+			throwError("%s is not a translated trace", filename.c_str());
+		}
+		map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) {
+			throwError("failed to map translated trace %s", filename.c_str());
+		}
+		madvise(map, size, MADV_SEQUENTIAL);
+		header = static_cast<const TranslatedFileHeader*>(map);
+		if (memcmp(header->magic, "HPTR", 4) != 0 || header->version != TRANSLATED_FILE_VERSION) {
+			munmap(map, size);
+			throwError("%s is not a version %u translated trace", filename.c_str(), TRANSLATED_FILE_VERSION);
+		}
+		records = reinterpret_cast<const TranslatedRecord*>(static_cast<const char*>(map) + sizeof(TranslatedFileHeader));
+		num_records = (size - sizeof(TranslatedFileHeader)) / sizeof(TranslatedRecord);
+		position = 0;
+	}
+	~TranslatedTraceReader()
+	{
+		munmap(map, size);
+	}
+	void checkConfig(const Config& config)
+	{
+		// the caches may differ from the recording run, the translation may not
+		uint64_t geometry[TRANSLATED_GEOMETRY_SIZE];
+		translationGeometry(config, geometry);
+		if (memcmp(header->geometry, geometry, sizeof(geometry)) != 0) {
+			throwError("translated trace %s was recorded with a different TLB or page configuration", filename.c_str());
+		}
+	}
+	size_t nextBatch(const TranslatedRecord *&batch)
+	{
+		// the records are used in place, see BinaryTraceReader
+		batch = records + position;
+		size_t n = min(num_records - position, BATCH_SIZE);
+		position += n;
+		return n;
+	}
+private:
+	static const size_t BATCH_SIZE = 1 << 16;
+
+	string filename;
+	void *map;
+	size_t size;
+	const TranslatedFileHeader *header;
+	const TranslatedRecord *records;
+	size_t num_records;
+	size_t position;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef WRITEBUFFER_H
+#define WRITEBUFFER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "checkpoint.h"
+#include "config.h"
+#include "statistics.h"
+
+using namespace std;
+
+// The write buffer between the last cache level and memory. Every store
+// and write-back that would write memory goes through write: a write to a
+// line the buffer holds merges into it, any other takes a new entry, which
+// costs the one memory write of its line whenever it drains. Lines drain
+// oldest first, write_buffer_age references after their first write or
+// when a new line finds the buffer full (a stall), and a memory read of a
+// line the buffer holds is served from it. Draining happens before each
+// access rather than on every reference, which changes no count.
+class WriteBuffer
+{
+public:
+	WriteBuffer(const Config& c, Statistics *s) : config(c)
+	{
+		stats = s;
+		count = 0;
+		memset(entries, 0, sizeof(entries));
+	}
+	// the last n references each wrote the line at address
+	void write(uint64_t address, unsigned long long n)
+	{
+		uint64_t line = address >> config.write_buffer_offset_bits;
+		unsigned long long now = stats->inst_refs + stats->data_refs - n + 1;
+		stats->write_buffer.writes += n;
+		while (n > 0) {
+			drainAged(now);
+			int i = find(line);
+			if (i >= 0) {
+				// the writes until the line drains merge into it
+				unsigned long long merged = n;
+				if (config.write_buffer_age > 0) {
+					merged = min(n, entries[i].written + config.write_buffer_age - now);
+				}
+				stats->write_buffer.coalesced += merged;
+				n -= merged;
+				now += merged;
+				continue;
+			}
+			if (count == config.write_buffer_entries) {
+				++stats->write_buffer.stalls;
+				remove(0, 1);
+			}
+			entries[count].line = line;
+			entries[count].written = now;
+			++count;
+			++stats->write_buffer.memory_writes;
+			++stats->memory_refs;
+			--n;
+			++now;
+		}
+	}
+	// a memory read of the line at address; true if the buffer served it
+	bool read(uint64_t address)
+	{
+		drainAged(stats->inst_refs + stats->data_refs);
+		if (find(address >> config.write_buffer_offset_bits) < 0) {
+			return false;
+		}
+		++stats->write_buffer.forwarded;
+		return true;
+	}
+	void drainPage(unsigned int phys_page_num)
+	{
+		// the lines of a page going to disk must reach memory first
+		int kept = 0;
+		for (int i = 0; i < count; ++i) {
+			uint64_t first = (entries[i].line << config.write_buffer_offset_bits) >> config.page_offset_bits;
+			uint64_t last = (((entries[i].line + 1) << config.write_buffer_offset_bits) - 1) >> config.page_offset_bits;
+			if (phys_page_num < first || phys_page_num > last) {
+				entries[kept++] = entries[i];
+			}
+		}
+		count = kept;
+	}
+	void save(CheckpointWriter& out)
+	{
+		out.write(&count, sizeof(count));
+		out.write(entries, sizeof(entries));
+	}
+	void restore(CheckpointReader& in)
+	{
+		in.read(&count, sizeof(count));
+		in.read(entries, sizeof(entries));
+	}
+private:
+	struct Entry
+	{
+		uint64_t line; // address >> write_buffer_offset_bits
+		unsigned long long written; // the reference of its first write
+	};
+
+	int find(uint64_t line)
+	{
+		for (int i = 0; i < count; ++i) {
+			if (entries[i].line == line) {
+				return i;
+			}
+		}
+		return -1;
+	}
+	void drainAged(unsigned long long now)
+	{
+		// the entries are in the order of their first writes
+		int aged = 0;
+		while (config.write_buffer_age > 0 && aged < count && entries[aged].written + config.write_buffer_age <= now) {
+			++aged;
+		}
+		remove(0, aged);
+	}
+	void remove(int first, int n)
+	{
+		memmove(entries + first, entries + first + n, (count - first - n) * sizeof(Entry));
+		count -= n;
+	}
+
+	const Config& config;
+	Statistics *stats;
+	int count;
+	Entry entries[MAX_WRITE_BUFFER_ENTRIES];
+};
+
+#endif
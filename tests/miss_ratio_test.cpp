@@ -0,0 +1,168 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "analysis.h"
+#include "config.h"
+#include "hierarchy.h"
+#include "trace.h"
+
+using namespace std;
+
+// Checks the miss ratio table of -m against a full simulation of single
+// LRU geometries, on synthetic traces under configurations with and
+// without virtual addresses, with lines smaller and larger than a page and
+// with a write-through data cache.
+
+const int CACHE_SETS[] = {1, 2, 4, 8, 32};
+const int CACHE_WAYS[] = {1, 2, 3, 5, 8};
+const int TLB_SETS[] = {1, 2, 4};
+const int TLB_WAYS[] = {1, 2, 3};
+const int TRACE_LENGTH = 20000;
+
+struct TestCase
+{
+	const char *name;
+	int page_size;
+	int physical_pages;
+	int instruction_line_size;
+	int data_line_size;
+	bool write_through;
+	bool virtual_addresses;
+	bool tlbs;
+};
+
+const TestCase TEST_CASES[] = {
+	{"lines larger than a page", 16, 8, 32, 32, false, true, true},
+	{"lines smaller than a page", 64, 8, 16, 16, false, true, true},
+	{"write-through, no TLBs", 16, 8, 64, 16, true, true, false},
+	{"physical addresses", 256, 256, 32, 16, false, false, false},
+	{"small lines, many faults", 32, 4, 4, 8, false, true, true},
+};
+
+Config makeConfig(const TestCase& test, int cache_sets, int cache_ways, int tlb_sets, int tlb_ways)
+{
+	Config config;
+	config.instruction_tlb_sets = tlb_sets;
+	config.instruction_tlb_set_size = tlb_ways;
+	config.data_tlb_sets = tlb_sets;
+	config.data_tlb_set_size = tlb_ways;
+	config.virtual_pages = 65536 / test.page_size; // the 16-bit trace addresses
+	config.physical_pages = test.physical_pages;
+	config.page_size = test.page_size;
+	config.instruction_cache_sets = cache_sets;
+	config.instruction_cache_set_size = cache_ways;
+	config.instruction_cache_line_size = test.instruction_line_size;
+	config.data_cache_sets = cache_sets;
+	config.data_cache_set_size = cache_ways;
+	config.data_cache_line_size = test.data_line_size;
+	config.data_cache_write_through = test.write_through;
+	config.virtual_addresses_enabled = test.virtual_addresses;
+	config.tlbs_enabled = test.tlbs;
+	config.instruction_tlb_policy = POLICY_LRU;
+	config.data_tlb_policy = POLICY_LRU;
+	config.frame_policy = POLICY_LRU;
+	config.instruction_cache_policy = POLICY_LRU;
+	config.data_cache_policy = POLICY_LRU;
+	config.replacement_seed = 0;
+	config.instruction_prefetcher = PREFETCH_NONE;
+	config.data_prefetcher = PREFETCH_NONE;
+	config.instruction_prefetch_degree = 1;
+	config.data_prefetch_degree = 1;
+	config.prefetch_latency = 0;
+	config.lower_levels = 0;
+	for (LevelConfig& l : config.levels) {
+		l.sets = 0;
+		l.set_size = 0;
+		l.line_size = 0;
+		l.inclusion = INCLUSION_NINE;
+		l.hit_latency = 0;
+	}
+	config.l1_hit_latency = 0;
+	config.memory_latency = 0;
+	config.write_buffer_entries = 0;
+	config.write_buffer_age = 0;
+	return finishConfig(config);
+}
+
+vector<TraceRecord> makeTrace(uint64_t seed)
+{
+	// instructions run through a few loops, data references mix a small
+	// hot region with the whole address space, so every geometry sees hits,
+	// misses and page faults
+	vector<TraceRecord> trace;
+	uint64_t random = seed;
+	uint64_t pc = 0x1000;
+	for (int i = 0; i < TRACE_LENGTH; ++i) {
+		random ^= random << 13;
+		random ^= random >> 7;
+		random ^= random << 17;
+		TraceRecord record;
+		if (random % 3 != 0) {
+			pc = (random % 16 == 0) ? 0x1000 + (random >> 8) % 0x800 * 4 : pc + 4;
+			record.address = pc & 0xffff;
+			record.stream_type = 'I';
+			record.access_type = 'R';
+		} else {
+			record.address = (random % 2 == 0) ? 0x8000 + (random >> 8) % 0x200 : (random >> 8) % 0x10000;
+			record.stream_type = 'D';
+			record.access_type = (random % 5 == 0) ? 'W' : 'R';
+		}
+		record.address_digits = 4;
+		record.reserved = 0;
+		record.repeats = 0;
+		trace.push_back(record);
+	}
+	return trace;
+}
+
+double missRatio(unsigned long long hits, unsigned long long misses)
+{
+	return (hits + misses > 0) ? (double)misses / (hits + misses) : 0.0;
+}
+
+int check(const char *test, const char *structure, int sets, int ways, double simulated, double analyzed)
+{
+	if (simulated == analyzed) {
+		return 0;
+	}
+	printf("%s: %s with %d sets of %d ways, simulated %f, -m %f\n", test, structure, sets, ways, simulated, analyzed);
+	return 1;
+}
+
+int main()
+{
+	int failures = 0;
+	int checks = 0;
+
+	for (const TestCase& test : TEST_CASES) {
+		vector<TraceRecord> trace = makeTrace(0x9e3779b97f4a7c15ull + test.page_size);
+		const Config analysis_config = makeConfig(test, 1, 1, 1, 1);
+		MissRatioAnalysis *analysis = new MissRatioAnalysis(analysis_config);
+		analysis->analyze(trace.data(), trace.size());
+		for (int g = 0; g < 5 * 5; ++g) {
+			int sets = CACHE_SETS[g / 5];
+			int ways = CACHE_WAYS[g % 5];
+			int tlb_sets = TLB_SETS[g % 3];
+			int tlb_ways = TLB_WAYS[g / 5 % 3];
+			const Config config = makeConfig(test, sets, ways, tlb_sets, tlb_ways);
+			Hierarchy *hierarchy = new Hierarchy(config);
+			hierarchy->accessMany(trace.data(), trace.size());
+			const Statistics& stats = hierarchy->statistics();
+			int width = __builtin_ctz(sets);
+			failures += check(test.name, "I-cache", sets, ways, missRatio(stats.ic_hits, stats.ic_misses), analysis->missRatio(true, false, width, ways));
+			failures += check(test.name, "D-cache", sets, ways, missRatio(stats.dc_hits, stats.dc_misses), analysis->missRatio(false, false, width, ways));
+			checks += 2;
+			if (test.tlbs) {
+				int tlb_width = __builtin_ctz(tlb_sets);
+				failures += check(test.name, "instruction TLB", tlb_sets, tlb_ways, missRatio(stats.itlb_hits, stats.itlb_misses), analysis->missRatio(true, true, tlb_width, tlb_ways));
+				failures += check(test.name, "data TLB", tlb_sets, tlb_ways, missRatio(stats.dtlb_hits, stats.dtlb_misses), analysis->missRatio(false, true, tlb_width, tlb_ways));
+				checks += 2;
+			}
+			delete hierarchy;
+		}
+		delete analysis;
+	}
+	printf("%d of %d miss ratios differ from the simulation\n", failures, checks);
+	return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}